@@ -0,0 +1,162 @@
+#include "AllocationTracker.h"
+
+#include <atomic>
+#include <new>
+
+#include <cstdlib>
+
+extern "C" {
+#include <graphics/image.h>
+}
+
+struct TagCounters {
+    std::atomic<std::uint64_t> Count, Bytes;
+};
+
+static TagCounters s_Counters[s_AllocationTagCount];
+static thread_local AllocationTag s_CurrentTag = AllocationTag::Untagged;
+
+const char* GetAllocationTagName(AllocationTag tag) {
+    switch (tag) {
+    case AllocationTag::Untagged:
+        return "Untagged";
+    case AllocationTag::Rasterizer:
+        return "Rasterizer";
+    case AllocationTag::Images:
+        return "Images";
+    case AllocationTag::PostProcess:
+        return "Post-processing";
+    case AllocationTag::Profiler:
+        return "Profiler";
+    case AllocationTag::UI:
+        return "UI";
+    default:
+        return "Unknown";
+    }
+}
+
+bool AllocationTracker::IsAvailable() {
+#ifdef TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocationTag AllocationTracker::GetCurrentTag() { return s_CurrentTag; }
+void AllocationTracker::SetCurrentTag(AllocationTag tag) { s_CurrentTag = tag; }
+
+void AllocationTracker::Record(std::size_t size) {
+    auto& counters = s_Counters[(std::uint32_t)s_CurrentTag];
+
+    counters.Count.fetch_add(1, std::memory_order_relaxed);
+    counters.Bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void AllocationTracker::EndFrame(AllocationStats* stats) {
+    for (std::uint32_t i = 0; i < s_AllocationTagCount; i++) {
+        stats[i].Count = s_Counters[i].Count.exchange(0, std::memory_order_relaxed);
+        stats[i].Bytes = s_Counters[i].Bytes.exchange(0, std::memory_order_relaxed);
+    }
+}
+
+#ifdef TRACK_ALLOCATIONS
+
+// the linker redirects every malloc call in the executable, rast included, to __wrap_malloc
+// (-Wl,--wrap=malloc); __real_malloc is the original
+extern "C" {
+void* __real_malloc(std::size_t size);
+void* __real_calloc(std::size_t count, std::size_t size);
+void* __real_realloc(void* block, std::size_t size);
+image_t* __real_image_allocate(uint32_t width, uint32_t height, image_format format);
+
+// c code running outside of any scope can only be rast; c++ code always goes through new
+static void RecordCAllocation(std::size_t size) {
+    if (s_CurrentTag != AllocationTag::Untagged) {
+        AllocationTracker::Record(size);
+        return;
+    }
+
+    AllocationScope scope(AllocationTag::Rasterizer);
+    AllocationTracker::Record(size);
+}
+
+void* __wrap_malloc(std::size_t size) {
+    RecordCAllocation(size);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(std::size_t count, std::size_t size) {
+    RecordCAllocation(count * size);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* block, std::size_t size) {
+    RecordCAllocation(size);
+    return __real_realloc(block, size);
+}
+
+image_t* __wrap_image_allocate(uint32_t width, uint32_t height, image_format format) {
+    AllocationScope scope(AllocationTag::Images);
+    return __real_image_allocate(width, height, format);
+}
+}
+
+static void* Allocate(std::size_t size) {
+    AllocationTracker::Record(size);
+
+    // malloc(0) may return null, which new must not. the real malloc, so this is not counted
+    // twice
+    void* block = __real_malloc(size > 0 ? size : 1);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return block;
+}
+
+static void* AllocateAligned(std::size_t size, std::align_val_t alignment) {
+    AllocationTracker::Record(size);
+
+    // aligned_alloc wants a multiple of the alignment
+    auto align = (std::size_t)alignment;
+    void* block = std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return block;
+}
+
+void* operator new(std::size_t size) { return Allocate(size); }
+void* operator new[](std::size_t size) { return Allocate(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    AllocationTracker::Record(size);
+    return __real_malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    AllocationTracker::Record(size);
+    return __real_malloc(size > 0 ? size : 1);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return AllocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return AllocateAligned(size, alignment);
+}
+
+void operator delete(void* block) noexcept { std::free(block); }
+void operator delete[](void* block) noexcept { std::free(block); }
+void operator delete(void* block, std::size_t) noexcept { std::free(block); }
+void operator delete[](void* block, std::size_t) noexcept { std::free(block); }
+void operator delete(void* block, std::align_val_t) noexcept { std::free(block); }
+void operator delete[](void* block, std::align_val_t) noexcept { std::free(block); }
+
+void operator delete(void* block, std::size_t, std::align_val_t) noexcept { std::free(block); }
+void operator delete[](void* block, std::size_t, std::align_val_t) noexcept { std::free(block); }
+
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// which part of the program an allocation is charged to
+enum class AllocationTag : std::uint8_t {
+    // no scope was active
+    Untagged,
+
+    // C allocations made by rast itself, e.g. its arenas and worker state
+    Rasterizer,
+
+    // anything allocated inside image_allocate
+    Images,
+
+    PostProcess,
+    Profiler,
+    UI,
+};
+
+static constexpr std::uint32_t s_AllocationTagCount = 6;
+
+const char* GetAllocationTagName(AllocationTag tag);
+
+struct AllocationStats {
+    std::uint64_t Count = 0;
+    std::uint64_t Bytes = 0;
+};
+
+// counts heap allocations per tag. only active when built with TRACK_ALLOCATIONS, which replaces
+// global operator new and wraps malloc, calloc, realloc and image_allocate at link time, so
+// allocations inside the statically linked rast are seen too. otherwise IsAvailable returns
+// false and every count stays zero
+class AllocationTracker {
+public:
+    static bool IsAvailable();
+
+    // the tag new allocations on the calling thread are charged to
+    static AllocationTag GetCurrentTag();
+    static void SetCurrentTag(AllocationTag tag);
+
+    static void Record(std::size_t size);
+
+    // writes s_AllocationTagCount entries with what was allocated since the previous call
+    static void EndFrame(AllocationStats* stats);
+};
+
+// charges allocations on this thread to a tag for the enclosing scope. WorkerPool carries the
+// dispatching thread's tag over to its workers
+class AllocationScope {
+public:
+    AllocationScope(AllocationTag tag) {
+        m_Previous = AllocationTracker::GetCurrentTag();
+        AllocationTracker::SetCurrentTag(tag);
+    }
+
+    ~AllocationScope() { AllocationTracker::SetCurrentTag(m_Previous); }
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+    AllocationTag m_Previous;
+};
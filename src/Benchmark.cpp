@@ -0,0 +1,129 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include <cstring>
+
+static void WriteCounters(std::ostream& stream, const CounterValues& counters, double frames,
+                          double pixels) {
+    stream << "\"cycles\": " << (double)counters.Get(HardwareCounter::Cycles) / frames
+           << ", \"instructions\": " << (double)counters.Get(HardwareCounter::Instructions) / frames
+           << ", \"ipc\": " << counters.GetIPC();
+
+    // misses are normalized per pixel, which is what the raster and post kernels scale with
+    static const HardwareCounter misses[] = { HardwareCounter::L1DMisses,
+                                              HardwareCounter::LLCMisses,
+                                              HardwareCounter::BranchMisses };
+
+    static const char* const names[] = { "l1d_misses_per_pixel", "llc_misses_per_pixel",
+                                         "branch_misses_per_pixel" };
+
+    for (std::size_t i = 0; i < std::size(misses); i++) {
+        double perPixel = pixels > 0 ? (double)counters.Get(misses[i]) / (frames * pixels) : 0.0;
+        stream << ", \"" << names[i] << "\": " << perPixel;
+    }
+}
+
+void BenchmarkRecorder::AddFrame(const TimestampQueryPool& timestamps, std::uint64_t pixels) {
+    std::uint64_t frame = timestamps.GetResultFrame();
+    if (IsDone() || frame == 0 || frame == m_LastFrame) {
+        return;
+    }
+
+    m_LastFrame = frame;
+    m_Recorded++;
+    m_Pixels = pixels;
+
+    const auto& results = timestamps.GetResults();
+    for (std::uint32_t i = 0; i < (std::uint32_t)results.size(); i++) {
+        const auto& result = results[i];
+
+        // stages are keyed by name; a stage can be missing from some frames (e.g. toggled off)
+        auto it = std::find_if(m_Stages.begin(), m_Stages.end(), [&](const Stage& stage) {
+            return std::strcmp(stage.Name, result.Name) == 0;
+        });
+
+        if (it == m_Stages.end()) {
+            it = m_Stages.insert(m_Stages.end(), { result.Name, 0, 0.0, {} });
+        }
+
+        it->Frames++;
+        it->Milliseconds += result.Milliseconds;
+        it->Counters += result.Counters;
+
+        auto counters = timestamps.GetHardwareCounters();
+        std::uint32_t threadCount = timestamps.GetResultThreadCount();
+
+        if (counters != nullptr && threadCount > 0) {
+            m_Threads.resize(std::max<std::size_t>(m_Threads.size(), threadCount));
+
+            for (std::uint32_t j = 0; j < threadCount; j++) {
+                m_Threads[j].Name = counters->GetThreadName(j);
+                m_Threads[j].Counters += timestamps.GetThreadCounters(i, j);
+            }
+        }
+    }
+}
+
+void BenchmarkRecorder::AddLatency(const LatencyRecorder::Frame& frame) {
+    if (m_LatencyTotals.size() >= m_FrameCount) {
+        return;
+    }
+
+    for (std::uint32_t i = 0; i < s_LatencyPointCount; i++) {
+        m_LatencySums[i] += frame.Milliseconds[i];
+    }
+
+    m_LatencyTotals.push_back(frame.GetTotal());
+}
+
+void BenchmarkRecorder::WriteJSON(std::ostream& stream) const {
+    double frames = std::max(m_Recorded, 1u);
+    double pixels = (double)m_Pixels;
+
+    stream << "{\n  \"frames\": " << m_Recorded << ",\n  \"pixels\": " << m_Pixels
+           << ",\n  \"stages\": [";
+
+    for (std::size_t i = 0; i < m_Stages.size(); i++) {
+        const auto& stage = m_Stages[i];
+        double stageFrames = std::max(stage.Frames, 1u);
+
+        stream << (i > 0 ? "," : "") << "\n    { \"name\": \"" << stage.Name
+               << "\", \"frames\": " << stage.Frames
+               << ", \"milliseconds\": " << stage.Milliseconds / stageFrames << ", ";
+
+        WriteCounters(stream, stage.Counters, stageFrames, pixels);
+        stream << " }";
+    }
+
+    // thread totals cover the timed ranges only, averaged over every recorded frame
+    stream << "\n  ],\n  \"threads\": [";
+
+    for (std::size_t i = 0; i < m_Threads.size(); i++) {
+        const auto& thread = m_Threads[i];
+
+        stream << (i > 0 ? "," : "") << "\n    { \"name\": \"" << thread.Name << "\", ";
+        WriteCounters(stream, thread.Counters, frames, pixels);
+        stream << " }";
+    }
+
+    stream << "\n  ],\n  \"latency\": {";
+
+    // each segment's average, then the whole chain from input to present
+    static const char* const segments[] = { "input_to_uniforms_ms", "uniforms_to_raster_ms",
+                                            "raster_to_present_ms" };
+
+    double latencyFrames = std::max<double>((double)m_LatencyTotals.size(), 1.0);
+    for (std::uint32_t i = 1; i < s_LatencyPointCount; i++) {
+        double segment = (m_LatencySums[i] - m_LatencySums[i - 1]) / latencyFrames;
+        stream << "\n    \"" << segments[i - 1] << "\": " << segment << ",";
+    }
+
+    auto totals = m_LatencyTotals;
+    std::sort(totals.begin(), totals.end());
+
+    double p99 = totals.empty() ? 0.0 : totals[(totals.size() * 99 + 99) / 100 - 1];
+    stream << "\n    \"total_ms\": " << m_LatencySums[s_LatencyPointCount - 1] / latencyFrames
+           << ",\n    \"total_p99_ms\": " << p99 << "\n  }\n}\n";
+}
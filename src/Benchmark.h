@@ -0,0 +1,60 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#include "TimestampQuery.h"
+#include "LatencyRecorder.h"
+
+// accumulates resolved timestamp query frames for a fixed-length run and writes per-stage and
+// per-thread averages as json
+class BenchmarkRecorder {
+public:
+    BenchmarkRecorder(std::uint32_t frameCount) {
+        m_FrameCount = frameCount;
+        m_LatencyTotals.reserve(frameCount);
+    }
+    ~BenchmarkRecorder() = default;
+
+    BenchmarkRecorder(const BenchmarkRecorder&) = delete;
+    BenchmarkRecorder& operator=(const BenchmarkRecorder&) = delete;
+
+    // records the pool's latest results if they belong to a frame not recorded yet. pixels is
+    // the framebuffer area, for the per-pixel miss rates
+    void AddFrame(const TimestampQueryPool& timestamps, std::uint64_t pixels);
+
+    // the latency chain of the frame that just ended; recorded for as many frames as AddFrame
+    void AddLatency(const LatencyRecorder::Frame& frame);
+
+    bool IsDone() const { return m_Recorded >= m_FrameCount; }
+
+    void WriteJSON(std::ostream& stream) const;
+
+private:
+    struct Stage {
+        const char* Name;
+        std::uint32_t Frames;
+
+        double Milliseconds;
+        CounterValues Counters;
+    };
+
+    struct Thread {
+        std::string Name;
+        CounterValues Counters;
+    };
+
+    std::uint32_t m_FrameCount;
+    std::uint32_t m_Recorded = 0;
+    std::uint64_t m_LastFrame = 0;
+    std::uint64_t m_Pixels = 0;
+
+    std::vector<Stage> m_Stages;
+    std::vector<Thread> m_Threads;
+
+    double m_LatencySums[s_LatencyPointCount] = {};
+    std::vector<double> m_LatencyTotals;
+};
@@ -0,0 +1,183 @@
+#include "ColorFormat.h"
+
+#include <algorithm>
+#include <bit>
+
+// the kernels below are written as branch-free per-pixel loops over planar input, so that the
+// compiler turns them into vector code without target-specific intrinsics
+
+static float Saturate(float value) { return std::min(std::max(value, 0.f), 1.f); }
+
+// round-to-nearest-even conversion after fabian giesen's float_to_half_fast3_rtne. every case is
+// computed and then selected so the loops calling this stay free of branches
+static std::uint32_t FloatToHalf(float value) {
+    static constexpr std::uint32_t denormalMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+
+    std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+    std::uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    // too large for a half, or already inf/nan
+    std::uint32_t infinite = bits > 0x7F800000u ? 0x7E00u : 0x7C00u;
+
+    // becomes a denormal; let the fpu round by adding a magic number
+    float shifted = std::bit_cast<float>(bits) + std::bit_cast<float>(denormalMagic);
+    std::uint32_t denormal = std::bit_cast<std::uint32_t>(shifted) - denormalMagic;
+
+    std::uint32_t mantissaOdd = (bits >> 13) & 1;
+    std::uint32_t normal = (bits + ((std::uint32_t)(15 - 127) << 23) + 0xFFF + mantissaOdd) >> 13;
+
+    std::uint32_t result = bits < 0x38800000u ? denormal : normal;
+    result = bits >= 0x47800000u ? infinite : result;
+
+    return result | (sign >> 16);
+}
+
+static float HalfToFloat(std::uint32_t value) {
+    static constexpr std::uint32_t shiftedExponent = 0x7C00u << 13;
+    static constexpr std::uint32_t denormalMagic = 113u << 23;
+
+    std::uint32_t bits = (value & 0x7FFFu) << 13;
+    std::uint32_t exponent = bits & shiftedExponent;
+    bits += (127 - 15) << 23;
+
+    std::uint32_t infinite = bits + ((128 - 16) << 23);
+    std::uint32_t denormal = std::bit_cast<std::uint32_t>(
+        std::bit_cast<float>(bits + (1 << 23)) - std::bit_cast<float>(denormalMagic));
+
+    bits = exponent == shiftedExponent ? infinite : bits;
+    bits = exponent == 0 ? denormal : bits;
+
+    bits |= (value & 0x8000u) << 16;
+    return std::bit_cast<float>(bits);
+}
+
+// the small unsigned floats share the half exponent and drop low mantissa bits. negatives and
+// nan go to zero; the input is capped below the largest finite 10-bit value so rounding cannot
+// overflow to infinity
+static std::uint32_t FloatToSmallFloat(float value, std::uint32_t droppedBits) {
+    float clamped = std::min(std::max(0.f, value), 64000.f);
+    std::uint32_t half = FloatToHalf(clamped);
+
+    return (half + (1u << (droppedBits - 1))) >> droppedBits;
+}
+
+static float SmallFloatToFloat(std::uint32_t value, std::uint32_t droppedBits) {
+    return HalfToFloat(value << droppedBits);
+}
+
+std::uint32_t GetBytesPerPixel(ColorFormat format) {
+    switch (format) {
+    case ColorFormat::RGB565:
+        return 2;
+    case ColorFormat::RGBA16F:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+const char* GetColorFormatName(ColorFormat format) {
+    switch (format) {
+    case ColorFormat::RGBA8:
+        return "RGBA8";
+    case ColorFormat::RGB565:
+        return "RGB565";
+    case ColorFormat::R11G11B10F:
+        return "R11G11B10F";
+    case ColorFormat::RGBA16F:
+        return "RGBA16F";
+    default:
+        return "Unknown";
+    }
+}
+
+void UnpackColorRow(ColorFormat format, const void* source, std::uint32_t count, float* r, float* g,
+                    float* b) {
+    switch (format) {
+    case ColorFormat::RGBA8: {
+        static constexpr float scale = 1.f / 255.f;
+        auto pixels = (const std::uint32_t*)source;
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            r[i] = (float)(pixels[i] >> 24) * scale;
+            g[i] = (float)((pixels[i] >> 16) & 0xFF) * scale;
+            b[i] = (float)((pixels[i] >> 8) & 0xFF) * scale;
+        }
+    } break;
+    case ColorFormat::RGB565: {
+        auto pixels = (const std::uint16_t*)source;
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            r[i] = (float)(pixels[i] >> 11) * (1.f / 31.f);
+            g[i] = (float)((pixels[i] >> 5) & 0x3F) * (1.f / 63.f);
+            b[i] = (float)(pixels[i] & 0x1F) * (1.f / 31.f);
+        }
+    } break;
+    case ColorFormat::R11G11B10F: {
+        auto pixels = (const std::uint32_t*)source;
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            r[i] = SmallFloatToFloat(pixels[i] & 0x7FF, 4);
+            g[i] = SmallFloatToFloat((pixels[i] >> 11) & 0x7FF, 4);
+            b[i] = SmallFloatToFloat(pixels[i] >> 22, 5);
+        }
+    } break;
+    case ColorFormat::RGBA16F: {
+        auto pixels = (const std::uint16_t*)source;
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            r[i] = HalfToFloat(pixels[i * 4]);
+            g[i] = HalfToFloat(pixels[i * 4 + 1]);
+            b[i] = HalfToFloat(pixels[i * 4 + 2]);
+        }
+    } break;
+    }
+}
+
+void PackColorRow(ColorFormat format, const float* r, const float* g, const float* b,
+                  std::uint32_t count, void* destination) {
+    switch (format) {
+    case ColorFormat::RGBA8: {
+        auto pixels = (std::uint32_t*)destination;
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            auto red = (std::uint32_t)(Saturate(r[i]) * 255.f + 0.5f);
+            auto green = (std::uint32_t)(Saturate(g[i]) * 255.f + 0.5f);
+            auto blue = (std::uint32_t)(Saturate(b[i]) * 255.f + 0.5f);
+
+            pixels[i] = (red << 24) | (green << 16) | (blue << 8) | 0xFF;
+        }
+    } break;
+    case ColorFormat::RGB565: {
+        auto pixels = (std::uint16_t*)destination;
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            auto red = (std::uint32_t)(Saturate(r[i]) * 31.f + 0.5f);
+            auto green = (std::uint32_t)(Saturate(g[i]) * 63.f + 0.5f);
+            auto blue = (std::uint32_t)(Saturate(b[i]) * 31.f + 0.5f);
+
+            pixels[i] = (std::uint16_t)((red << 11) | (green << 5) | blue);
+        }
+    } break;
+    case ColorFormat::R11G11B10F: {
+        auto pixels = (std::uint32_t*)destination;
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            pixels[i] = FloatToSmallFloat(r[i], 4) | (FloatToSmallFloat(g[i], 4) << 11) |
+                        (FloatToSmallFloat(b[i], 5) << 22);
+        }
+    } break;
+    case ColorFormat::RGBA16F: {
+        static constexpr std::uint16_t one = 0x3C00;
+        auto pixels = (std::uint16_t*)destination;
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            pixels[i * 4] = (std::uint16_t)FloatToHalf(r[i]);
+            pixels[i * 4 + 1] = (std::uint16_t)FloatToHalf(g[i]);
+            pixels[i * 4 + 2] = (std::uint16_t)FloatToHalf(b[i]);
+            pixels[i * 4 + 3] = one;
+        }
+    } break;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "HugePages.h"
+
+enum class ColorFormat {
+    // 0xRRGGBBAA, matching the rasterizer's color attachments
+    RGBA8,
+
+    // 5-6-5 unorm, red in the high bits. values are clamped to [0, 1]
+    RGB565,
+
+    // packed unsigned floats: 11-bit red and green, 10-bit blue, red in the low bits
+    R11G11B10F,
+
+    // four half floats
+    RGBA16F,
+};
+
+std::uint32_t GetBytesPerPixel(ColorFormat format);
+const char* GetColorFormatName(ColorFormat format);
+
+// convert count pixels between a packed row and planar rgb floats. no transfer function is
+// applied; alpha is dropped on unpack and written as opaque on pack
+void UnpackColorRow(ColorFormat format, const void* source, std::uint32_t count, float* r, float* g,
+                    float* b);
+
+void PackColorRow(ColorFormat format, const float* r, const float* g, const float* b,
+                  std::uint32_t count, void* destination);
+
+// row kernels work on whole multiples of this many pixels, a 64-byte vector of floats, so odd
+// widths such as 1601 leave no scalar tail
+static constexpr std::uint32_t s_RowPixelMultiple = 16;
+
+// rows of cpu-side images start on this boundary
+static constexpr std::uint32_t s_RowAlignment = 64;
+
+constexpr std::uint32_t GetPaddedWidth(std::uint32_t width) {
+    return (width + s_RowPixelMultiple - 1) / s_RowPixelMultiple * s_RowPixelMultiple;
+}
+
+// a cpu-side render target in any ColorFormat. rows are Pitch bytes apart and hold at least
+// GetPaddedWidth(Width) pixels; the ones past Width are scratch that kernels may overwrite freely
+struct ColorImage {
+    std::uint32_t Width = 0, Height = 0;
+    std::size_t Pitch = 0;
+
+    ColorFormat Format = ColorFormat::RGBA8;
+    LargeVector<std::uint8_t> Data;
+
+    void Allocate(std::uint32_t width, std::uint32_t height, ColorFormat format) {
+        std::uint32_t bytesPerPixel = GetBytesPerPixel(format);
+
+        Width = width;
+        Height = height;
+        Format = format;
+
+        Pitch = (std::size_t)GetPaddedWidth(width) * bytesPerPixel;
+        Pitch = (Pitch + s_RowAlignment - 1) / s_RowAlignment * s_RowAlignment;
+
+        Data.resize(Pitch * height);
+    }
+
+    void* GetRow(std::uint32_t y) { return Data.data() + (std::size_t)y * Pitch; }
+    const void* GetRow(std::uint32_t y) const { return Data.data() + (std::size_t)y * Pitch; }
+};
@@ -0,0 +1,79 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+static constexpr auto s_MinSpinMargin = std::chrono::microseconds(100);
+static constexpr auto s_MaxSpinMargin = std::chrono::microseconds(4000);
+
+FramePacer::FramePacer(double targetRate) {
+    m_TargetRate = targetRate;
+    m_IdleRate = 10.0;
+
+    m_IdleFrames = m_QuietFrames = 0;
+    m_Idle = false;
+
+    m_Deadline = Clock::now();
+    m_SpinMargin = std::chrono::microseconds(1000);
+}
+
+void FramePacer::SetTargetRate(double rate) {
+    m_TargetRate = rate;
+    m_Deadline = Clock::now();
+}
+
+bool FramePacer::ShouldRender(bool changed) {
+    m_QuietFrames = changed ? 0 : std::min(m_QuietFrames + 1, m_IdleFrames);
+
+    bool idle = m_IdleFrames > 0 && m_QuietFrames >= m_IdleFrames;
+    if (m_Idle && !idle) {
+        // the schedule would otherwise be a whole idle period behind
+        m_Deadline = Clock::now();
+    }
+
+    m_Idle = idle;
+    return !m_Idle;
+}
+
+void FramePacer::Wait() {
+    double rate = m_Idle ? m_IdleRate : m_TargetRate;
+    auto now = Clock::now();
+
+    if (rate <= 0.0) {
+        m_Deadline = now;
+        return;
+    }
+
+    auto period =
+        std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+    m_Deadline += period;
+
+    // a late frame restarts the schedule from now, however little it missed by; keeping the old
+    // deadline would make the next frame due sooner than a period away
+    if (now >= m_Deadline) {
+        m_Deadline = now;
+        return;
+    }
+
+    // nothing is on screen to be late while idle
+    if (m_Idle) {
+        std::this_thread::sleep_until(m_Deadline);
+        return;
+    }
+
+    auto wakeUp = m_Deadline - m_SpinMargin;
+    if (wakeUp > now) {
+        std::this_thread::sleep_until(wakeUp);
+
+        // grow right away when the os wakes us later than the margin allows for, shrink slowly
+        // when it keeps being early
+        auto overshoot = Clock::now() - wakeUp;
+        m_SpinMargin = std::clamp<Clock::duration>(
+            std::max<Clock::duration>(overshoot + overshoot / 4, m_SpinMargin - m_SpinMargin / 64),
+            s_MinSpinMargin, s_MaxSpinMargin);
+    }
+
+    while (Clock::now() < m_Deadline) {
+        std::this_thread::yield();
+    }
+}
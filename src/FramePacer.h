@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+
+#include <cstdint>
+
+// holds the render loop to a target frame rate without burning a core. each wait sleeps until
+// shortly before the deadline and spins the rest of the way; the spin margin follows how late
+// the os has been waking the thread up. with idle frames set, the loop stops rendering after
+// that many frames in a row without changes and only checks for input at a low rate
+class FramePacer {
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    FramePacer(double targetRate = 0.0);
+    ~FramePacer() = default;
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    // frames per second; 0 does not wait at all
+    void SetTargetRate(double rate);
+    double GetTargetRate() const { return m_TargetRate; }
+
+    // 0 never goes idle
+    void SetIdleFrames(std::uint32_t frames) { m_IdleFrames = frames; }
+    std::uint32_t GetIdleFrames() const { return m_IdleFrames; }
+
+    // how often an idle loop checks for input
+    void SetIdleRate(double rate) { m_IdleRate = rate; }
+    double GetIdleRate() const { return m_IdleRate; }
+
+    // called once per loop iteration with whether anything changed since the last one. returns
+    // false while idle; the iteration should then skip rendering and go straight to Wait
+    bool ShouldRender(bool changed);
+
+    bool IsIdle() const { return m_Idle; }
+
+    // blocks until the next frame is due. a frame that already missed its deadline returns right
+    // away, and the schedule restarts from it instead of rushing to catch up
+    void Wait();
+
+    double GetSpinMarginMilliseconds() const {
+        return std::chrono::duration<double, std::milli>(m_SpinMargin).count();
+    }
+
+private:
+    double m_TargetRate, m_IdleRate;
+    std::uint32_t m_IdleFrames, m_QuietFrames;
+    bool m_Idle;
+
+    Clock::time_point m_Deadline;
+    Clock::duration m_SpinMargin;
+};
@@ -0,0 +1,113 @@
+#include "FrameTimeRecorder.h"
+
+#include <algorithm>
+#include <cmath>
+
+FrameTimeRecorder::FrameTimeRecorder(std::uint32_t windowSize) {
+    m_Samples.resize(windowSize);
+    m_Next = m_Count = 0;
+
+    std::fill_n(m_Histogram, BucketCount, 0.f);
+
+    m_Sorted.reserve(windowSize);
+    m_SortedValid = false;
+
+    m_WorstCount = 0;
+}
+
+std::uint32_t FrameTimeRecorder::GetBucket(double milliseconds) {
+    auto bucket = (std::uint32_t)std::max(milliseconds / BucketMilliseconds, 0.0);
+    return std::min(bucket, BucketCount - 1);
+}
+
+void FrameTimeRecorder::AddFrame(std::uint64_t frame, double milliseconds) {
+    auto windowSize = (std::uint32_t)m_Samples.size();
+    auto& sample = m_Samples[m_Next];
+
+    if (m_Count == windowSize) {
+        m_Histogram[GetBucket(sample.Milliseconds)]--;
+    } else {
+        m_Count++;
+    }
+
+    sample.Frame = frame;
+    sample.Milliseconds = milliseconds;
+    m_Histogram[GetBucket(milliseconds)]++;
+
+    m_Next = (m_Next + 1) % windowSize;
+    m_SortedValid = false;
+
+    // worst frames that left the window go with it
+    std::uint64_t oldest = m_Samples[m_Count == windowSize ? m_Next : 0].Frame;
+    auto end = std::remove_if(m_Worst, m_Worst + m_WorstCount,
+                              [&](const WorstFrame& worst) { return worst.Frame < oldest; });
+
+    m_WorstCount = (std::uint32_t)(end - m_Worst);
+
+    // sorted slowest first, so the last entry is the one to beat
+    if (m_WorstCount == WorstFrameCount) {
+        if (milliseconds <= m_Worst[WorstFrameCount - 1].Milliseconds) {
+            return;
+        }
+
+        m_WorstCount--;
+    }
+
+    std::uint32_t index = m_WorstCount++;
+    while (index > 0 && m_Worst[index - 1].Milliseconds < milliseconds) {
+        m_Worst[index] = m_Worst[index - 1];
+        index--;
+    }
+
+    m_Worst[index].Frame = frame;
+    m_Worst[index].Milliseconds = milliseconds;
+    m_Worst[index].StageCount = 0;
+}
+
+void FrameTimeRecorder::AddStages(const TimestampQueryPool& timestamps) {
+    std::uint64_t frame = timestamps.GetResultFrame();
+
+    for (std::uint32_t i = 0; i < m_WorstCount; i++) {
+        auto& worst = m_Worst[i];
+        if (worst.Frame != frame) {
+            continue;
+        }
+
+        const auto& results = timestamps.GetResults();
+        worst.StageCount = std::min((std::uint32_t)results.size(), MaxStages);
+
+        for (std::uint32_t j = 0; j < worst.StageCount; j++) {
+            worst.Stages[j] = { results[j].Name, results[j].Milliseconds };
+        }
+    }
+}
+
+double FrameTimeRecorder::GetPercentile(double percentile) const {
+    if (m_Count == 0) {
+        return 0.0;
+    }
+
+    if (!m_SortedValid) {
+        m_Sorted.clear();
+        for (std::uint32_t i = 0; i < m_Count; i++) {
+            m_Sorted.push_back(m_Samples[i].Milliseconds);
+        }
+
+        std::sort(m_Sorted.begin(), m_Sorted.end());
+        m_SortedValid = true;
+    }
+
+    auto rank = (std::uint32_t)std::ceil(percentile / 100.0 * m_Count);
+    return m_Sorted[std::clamp(rank, 1u, m_Count) - 1];
+}
+
+void FrameTimeRecorder::WriteCSV(std::ostream& stream) const {
+    auto windowSize = (std::uint32_t)m_Samples.size();
+    std::uint32_t first = m_Count == windowSize ? m_Next : 0;
+
+    stream << "frame,milliseconds\n";
+    for (std::uint32_t i = 0; i < m_Count; i++) {
+        const auto& sample = m_Samples[(first + i) % windowSize];
+        stream << sample.Frame << "," << sample.Milliseconds << "\n";
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include <cstdint>
+
+#include "TimestampQuery.h"
+
+// rolling window of frame times with a histogram, percentiles and the stage breakdown of the
+// slowest frames. nothing allocates after construction
+class FrameTimeRecorder {
+public:
+    static constexpr std::uint32_t BucketCount = 100;
+    static constexpr double BucketMilliseconds = 0.5;
+
+    static constexpr std::uint32_t WorstFrameCount = 8;
+    static constexpr std::uint32_t MaxStages = 16;
+
+    struct Stage {
+        const char* Name;
+        double Milliseconds;
+    };
+
+    struct WorstFrame {
+        std::uint64_t Frame;
+        double Milliseconds;
+
+        // empty until the frame's timestamp queries were resolved
+        std::uint32_t StageCount;
+        Stage Stages[MaxStages];
+    };
+
+    FrameTimeRecorder(std::uint32_t windowSize = 4096);
+    ~FrameTimeRecorder() = default;
+
+    FrameTimeRecorder(const FrameTimeRecorder&) = delete;
+    FrameTimeRecorder& operator=(const FrameTimeRecorder&) = delete;
+
+    void AddFrame(std::uint64_t frame, double milliseconds);
+
+    // attaches the pool's latest results to the matching worst frame, if it is one. timestamp
+    // results arrive a few frames after the frame time, so this is called separately
+    void AddStages(const TimestampQueryPool& timestamps);
+
+    std::uint32_t GetFrameCount() const { return m_Count; }
+
+    // percentile in [0, 100] over the window, by nearest rank
+    double GetPercentile(double percentile) const;
+
+    // BucketCount buckets of BucketMilliseconds each; the last one also counts everything slower
+    const float* GetHistogram() const { return m_Histogram; }
+
+    // slowest first; WorstFrameCount entries at most
+    std::uint32_t GetWorstFrameCount() const { return m_WorstCount; }
+    const WorstFrame& GetWorstFrame(std::uint32_t index) const { return m_Worst[index]; }
+
+    // one frame,milliseconds row per frame in the window, oldest first
+    void WriteCSV(std::ostream& stream) const;
+
+private:
+    struct Sample {
+        std::uint64_t Frame;
+        double Milliseconds;
+    };
+
+    static std::uint32_t GetBucket(double milliseconds);
+
+    std::vector<Sample> m_Samples;
+    std::uint32_t m_Next, m_Count;
+
+    float m_Histogram[BucketCount];
+
+    // the window is sorted into this on demand
+    mutable std::vector<double> m_Sorted;
+    mutable bool m_SortedValid;
+
+    WorstFrame m_Worst[WorstFrameCount];
+    std::uint32_t m_WorstCount;
+};
@@ -0,0 +1,177 @@
+#include "HardwareCounters.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <cstdlib>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <linux/perf_event.h>
+#endif
+
+const char* GetHardwareCounterName(HardwareCounter counter) {
+    switch (counter) {
+    case HardwareCounter::Cycles:
+        return "Cycles";
+    case HardwareCounter::Instructions:
+        return "Instructions";
+    case HardwareCounter::L1DMisses:
+        return "L1D misses";
+    case HardwareCounter::LLCMisses:
+        return "LLC misses";
+    case HardwareCounter::BranchMisses:
+        return "Branch misses";
+    default:
+        return "Unknown";
+    }
+}
+
+#ifdef __linux__
+
+static constexpr std::uint64_t CacheMissConfig(std::uint64_t cache) {
+    return cache | ((std::uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           ((std::uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+static int OpenCounter(HardwareCounter counter, int threadID, int groupFD) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (counter) {
+    case HardwareCounter::Cycles:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case HardwareCounter::Instructions:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case HardwareCounter::L1DMisses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = CacheMissConfig(PERF_COUNT_HW_CACHE_L1D);
+        break;
+    case HardwareCounter::LLCMisses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = CacheMissConfig(PERF_COUNT_HW_CACHE_LL);
+        break;
+    case HardwareCounter::BranchMisses:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    }
+
+    return (int)syscall(SYS_perf_event_open, &attr, threadID, -1, groupFD, PERF_FLAG_FD_CLOEXEC);
+}
+
+static std::string ReadThreadName(int threadID) {
+    std::ifstream stream("/proc/self/task/" + std::to_string(threadID) + "/comm");
+
+    std::string name;
+    std::getline(stream, name);
+
+    return name + " (" + std::to_string(threadID) + ")";
+}
+
+HardwareCounters::HardwareCounters() {
+    std::fill_n(m_Supported, s_HardwareCounterCount, false);
+    Refresh();
+}
+
+HardwareCounters::~HardwareCounters() {
+    for (const auto& thread : m_Threads) {
+        for (int fd : thread.Members) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+}
+
+bool HardwareCounters::OpenThread(int threadID, Thread& thread) {
+    thread.ThreadID = threadID;
+    thread.Name = ReadThreadName(threadID);
+    std::fill_n(thread.Members, s_HardwareCounterCount, -1);
+
+    // cycles lead the group so that every member is scheduled onto the pmu together
+    thread.Leader = OpenCounter(HardwareCounter::Cycles, threadID, -1);
+    if (thread.Leader < 0) {
+        return false;
+    }
+
+    thread.Members[0] = thread.Leader;
+    for (std::uint32_t i = 1; i < s_HardwareCounterCount; i++) {
+        thread.Members[i] = OpenCounter((HardwareCounter)i, threadID, thread.Leader);
+    }
+
+    for (std::uint32_t i = 0; i < s_HardwareCounterCount; i++) {
+        m_Supported[i] |= thread.Members[i] >= 0;
+    }
+
+    return true;
+}
+
+void HardwareCounters::Refresh() {
+    DIR* directory = opendir("/proc/self/task");
+    if (directory == nullptr) {
+        return;
+    }
+
+    while (dirent* entry = readdir(directory)) {
+        int threadID = atoi(entry->d_name);
+        if (threadID <= 0) {
+            continue;
+        }
+
+        auto it = std::find_if(m_Threads.begin(), m_Threads.end(),
+                               [&](const Thread& thread) { return thread.ThreadID == threadID; });
+
+        Thread thread;
+        if (it == m_Threads.end() && OpenThread(threadID, thread)) {
+            m_Threads.push_back(std::move(thread));
+        }
+    }
+
+    closedir(directory);
+}
+
+void HardwareCounters::Sample(CounterValues* values, std::uint32_t count) {
+    // nr, time enabled, time running, then one value per member in the order they were opened
+    std::uint64_t buffer[3 + s_HardwareCounterCount];
+
+    for (std::size_t i = 0; i < std::min((std::size_t)count, m_Threads.size()); i++) {
+        auto& thread = m_Threads[i];
+
+        ssize_t size = read(thread.Leader, buffer, sizeof(buffer));
+        if (size >= (ssize_t)(3 * sizeof(std::uint64_t)) && buffer[2] > 0) {
+            double scale = (double)buffer[1] / (double)buffer[2];
+
+            std::uint32_t member = 0;
+            for (std::uint32_t j = 0; j < s_HardwareCounterCount && member < buffer[0]; j++) {
+                if (thread.Members[j] >= 0) {
+                    thread.Last.Values[j] = (std::uint64_t)((double)buffer[3 + member++] * scale);
+                }
+            }
+        }
+
+        values[i] = thread.Last;
+    }
+}
+
+#else
+
+HardwareCounters::HardwareCounters() { std::fill_n(m_Supported, s_HardwareCounterCount, false); }
+HardwareCounters::~HardwareCounters() = default;
+
+bool HardwareCounters::OpenThread(int threadID, Thread& thread) { return false; }
+void HardwareCounters::Refresh() {}
+void HardwareCounters::Sample(CounterValues* values, std::uint32_t count) {}
+
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+enum class HardwareCounter {
+    Cycles,
+    Instructions,
+    L1DMisses,
+    LLCMisses,
+    BranchMisses,
+};
+
+static constexpr std::uint32_t s_HardwareCounterCount = 5;
+
+const char* GetHardwareCounterName(HardwareCounter counter);
+
+struct CounterValues {
+    std::uint64_t Values[s_HardwareCounterCount] = {};
+
+    std::uint64_t Get(HardwareCounter counter) const { return Values[(std::uint32_t)counter]; }
+
+    double GetIPC() const {
+        std::uint64_t cycles = Get(HardwareCounter::Cycles);
+        return cycles > 0 ? (double)Get(HardwareCounter::Instructions) / (double)cycles : 0.0;
+    }
+
+    CounterValues& operator+=(const CounterValues& other) {
+        for (std::uint32_t i = 0; i < s_HardwareCounterCount; i++) {
+            Values[i] += other.Values[i];
+        }
+
+        return *this;
+    }
+};
+
+// hardware performance counters for every thread in the process, including the rasterizer's
+// own workers, read through perf_event_open. counts are user-space only and scaled when the
+// kernel had to multiplex them. on other platforms, or when perf events are not permitted
+// (see /proc/sys/kernel/perf_event_paranoid), IsAvailable returns false and samples stay zero
+class HardwareCounters {
+public:
+    HardwareCounters();
+    ~HardwareCounters();
+
+    HardwareCounters(const HardwareCounters&) = delete;
+    HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+    bool IsAvailable() const { return !m_Threads.empty(); }
+
+    // whether the cpu exposes a counter; missing ones read as zero
+    bool IsSupported(HardwareCounter counter) const {
+        return m_Supported[(std::uint32_t)counter];
+    }
+
+    // opens counters for threads started since the last call. threads are only ever appended,
+    // so indices stay stable
+    void Refresh();
+
+    std::uint32_t GetThreadCount() const { return (std::uint32_t)m_Threads.size(); }
+    const std::string& GetThreadName(std::uint32_t index) const { return m_Threads[index].Name; }
+
+    // writes running totals for the first count threads. threads that exited keep their last
+    // values
+    void Sample(CounterValues* values, std::uint32_t count);
+
+private:
+    struct Thread {
+        int ThreadID;
+        std::string Name;
+
+        int Leader;
+        int Members[s_HardwareCounterCount];
+
+        CounterValues Last;
+    };
+
+    bool OpenThread(int threadID, Thread& thread);
+
+    std::vector<Thread> m_Threads;
+    bool m_Supported[s_HardwareCounterCount];
+};
@@ -0,0 +1,125 @@
+#include "HugePages.h"
+#include "WorkerPool.h"
+#include "AllocationTracker.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// older headers lack these; kernels without them reject the call, which is only a missed hint
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+#ifndef MADV_COLLAPSE
+#define MADV_COLLAPSE 25
+#endif
+
+static std::atomic<HugePageMode> s_Mode = HugePageMode::Off;
+
+const char* GetHugePageModeName(HugePageMode mode) {
+    switch (mode) {
+    case HugePageMode::Off:
+        return "Off";
+    case HugePageMode::Transparent:
+        return "Transparent";
+    case HugePageMode::Explicit:
+        return "Explicit";
+    default:
+        return "Unknown";
+    }
+}
+
+static std::size_t RoundUp(std::size_t size) {
+    return (size + HugePages::PageSize - 1) & ~(HugePages::PageSize - 1);
+}
+
+void HugePages::SetMode(HugePageMode mode) { s_Mode.store(mode, std::memory_order_relaxed); }
+HugePageMode HugePages::GetMode() { return s_Mode.load(std::memory_order_relaxed); }
+
+void* HugePages::Allocate(std::size_t size) {
+    AllocationTracker::Record(size);
+    size = RoundUp(size);
+
+#ifdef __linux__
+    HugePageMode mode = GetMode();
+    if (mode == HugePageMode::Explicit) {
+        void* block = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (block != MAP_FAILED) {
+            return block;
+        }
+    }
+
+    // over-map by a page so the block can start on a 2 MiB boundary; the kernel only backs
+    // aligned 2 MiB ranges with huge pages
+    std::size_t mappedSize = size + PageSize;
+    void* mapping =
+        mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+
+    auto begin = (std::uintptr_t)mapping;
+    auto aligned = (begin + PageSize - 1) & ~(std::uintptr_t)(PageSize - 1);
+
+    if (aligned > begin) {
+        munmap(mapping, aligned - begin);
+    }
+
+    std::size_t tail = (begin + mappedSize) - (aligned + size);
+    if (tail > 0) {
+        munmap((void*)(aligned + size), tail);
+    }
+
+    if (mode != HugePageMode::Off) {
+        madvise((void*)aligned, size, MADV_HUGEPAGE);
+    }
+
+    return (void*)aligned;
+#else
+    return ::operator new(size, std::align_val_t(PageSize), std::nothrow);
+#endif
+}
+
+void HugePages::Free(void* block, std::size_t size) {
+    if (block == nullptr) {
+        return;
+    }
+
+#ifdef __linux__
+    munmap(block, RoundUp(size));
+#else
+    ::operator delete(block, std::align_val_t(PageSize));
+#endif
+}
+
+void HugePages::Back(WorkerPool& pool, void* data, std::size_t size) {
+#ifdef __linux__
+    if (GetMode() == HugePageMode::Off || data == nullptr || size == 0) {
+        return;
+    }
+
+    // whole huge pages inside the range only
+    auto begin = ((std::uintptr_t)data + PageSize - 1) & ~(std::uintptr_t)(PageSize - 1);
+    auto end = ((std::uintptr_t)data + size) & ~(std::uintptr_t)(PageSize - 1);
+
+    if (end <= begin) {
+        return;
+    }
+
+    madvise((void*)begin, end - begin, MADV_HUGEPAGE);
+
+    // populating only faults in what is missing and keeps the contents; collapsing rewrites what
+    // was faulted in as 4 KiB pages before the advice. both fail harmlessly on older kernels
+    auto pageCount = (std::uint32_t)((end - begin) / PageSize);
+    pool.ParallelFor(pageCount, [&](std::uint32_t page) {
+        auto address = (void*)(begin + (std::uintptr_t)page * PageSize);
+
+        madvise(address, PageSize, MADV_POPULATE_WRITE);
+        madvise(address, PageSize, MADV_COLLAPSE);
+    });
+#endif
+}
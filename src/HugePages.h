@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+class WorkerPool;
+
+enum class HugePageMode {
+    // large buffers get ordinary mappings; the system's transparent huge page default applies
+    Off,
+
+    // large buffers and images are marked MADV_HUGEPAGE
+    Transparent,
+
+    // large buffers come from the reserved hugetlbfs pool (vm.nr_hugepages), falling back to
+    // transparent huge pages once it runs dry. images from image_allocate can only be advised
+    Explicit,
+};
+
+static constexpr std::uint32_t s_HugePageModeCount = 3;
+
+const char* GetHugePageModeName(HugePageMode mode);
+
+// 2 MiB page backing for the large buffers that depth testing, binning and post-processing
+// stride through. a single 4k target spans thousands of 4 KiB pages, more than the tlb covers
+class HugePages {
+public:
+    static constexpr std::size_t PageSize = 2 * 1024 * 1024;
+
+    // allocations this large or larger are mapped on their own
+    static constexpr std::size_t MinAllocation = PageSize;
+
+    // applies to allocations made afterwards
+    static void SetMode(HugePageMode mode);
+    static HugePageMode GetMode();
+
+    // size must be at least MinAllocation. returns null if the mapping failed
+    static void* Allocate(std::size_t size);
+    static void Free(void* block, std::size_t size);
+
+    // for memory that was not allocated here, e.g. image data: marks the 2 MiB aligned part of
+    // the range for huge pages, faults it in on pool's threads, each taking the part of the range
+    // it owns in ParallelFor, and collapses pages that were faulted in before into huge pages.
+    // the range is rounded inward to whole huge pages, so heap memory from malloc that lies
+    // around it is never advised. does nothing with the mode off, or for a null or empty range
+    static void Back(WorkerPool& pool, void* data, std::size_t size);
+};
+
+// std::vector allocator that maps large blocks through HugePages and leaves small ones to the
+// heap. either way blocks start on a cache line
+template <typename T>
+struct HugePageAllocator {
+    using value_type = T;
+
+    static constexpr std::size_t Alignment = 64;
+
+    HugePageAllocator() = default;
+
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U>&) {}
+
+    T* allocate(std::size_t count) {
+        std::size_t size = count * sizeof(T);
+        if (size < HugePages::MinAllocation) {
+            return (T*)::operator new(size, std::align_val_t(Alignment));
+        }
+
+        void* block = HugePages::Allocate(size);
+        if (block == nullptr) {
+            throw std::bad_alloc();
+        }
+
+        return (T*)block;
+    }
+
+    void deallocate(T* block, std::size_t count) {
+        std::size_t size = count * sizeof(T);
+        if (size < HugePages::MinAllocation) {
+            ::operator delete(block, std::align_val_t(Alignment));
+        } else {
+            HugePages::Free(block, size);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U>&) const {
+        return true;
+    }
+};
+
+template <typename T>
+using LargeVector = std::vector<T, HugePageAllocator<T>>;
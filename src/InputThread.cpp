@@ -0,0 +1,144 @@
+#include "InputThread.h"
+
+#include <algorithm>
+
+#include <cstring>
+
+#include <pthread.h>
+
+InputThread::InputThread(window_t* window, std::chrono::microseconds interval) {
+    m_Window = window;
+    m_Interval = interval;
+    m_IntervalChanged = false;
+    m_Stop = false;
+    m_PendingFrame = nullptr;
+
+    window_get_framebuffer_size(m_Window, &m_Width, &m_Height);
+    m_ResizePending = m_CloseSent = false;
+
+    InputState state;
+    state.SampledAt = Clock::now();
+    state.Width = m_Width;
+    state.Height = m_Height;
+    m_State.Publish(state);
+}
+
+void InputThread::Run() {
+    pthread_setname_np(pthread_self(), "input");
+
+    while (!m_Stop.load(std::memory_order_acquire)) {
+        Poll();
+
+        std::unique_lock lock(m_PresentMutex);
+        m_PresentRequested.wait_for(lock, m_Interval, [&]() {
+            return m_PendingFrame != nullptr || m_IntervalChanged ||
+                   m_Stop.load(std::memory_order_acquire);
+        });
+
+        m_IntervalChanged = false;
+
+        if (m_PendingFrame != nullptr) {
+            CopyToBackbuffer(m_PendingFrame);
+            window_swap_buffers(m_Window);
+
+            m_PendingFrame = nullptr;
+            m_PresentDone.notify_all();
+        }
+    }
+}
+
+void InputThread::Stop() {
+    {
+        std::lock_guard lock(m_PresentMutex);
+        m_Stop.store(true, std::memory_order_release);
+    }
+
+    m_PresentRequested.notify_all();
+}
+
+void InputThread::SetInterval(std::chrono::microseconds interval) {
+    {
+        std::lock_guard lock(m_PresentMutex);
+        if (interval == m_Interval) {
+            return;
+        }
+
+        m_Interval = interval;
+        m_IntervalChanged = true;
+    }
+
+    m_PresentRequested.notify_all();
+}
+
+std::chrono::microseconds InputThread::GetInterval() {
+    std::lock_guard lock(m_PresentMutex);
+    return m_Interval;
+}
+
+void InputThread::Present(const image_t* color) {
+    std::unique_lock lock(m_PresentMutex);
+
+    m_PendingFrame = color;
+    m_PresentRequested.notify_all();
+
+    m_PresentDone.wait(lock, [&]() { return m_PendingFrame == nullptr; });
+}
+
+void InputThread::SetSampleCallback(SampleCallback callback) {
+    std::lock_guard lock(m_CallbackMutex);
+    m_SampleCallback = std::move(callback);
+}
+
+void InputThread::Poll() {
+    {
+        std::lock_guard lock(m_ImGuiMutex);
+        window_poll();
+    }
+
+    InputState state;
+    state.SampledAt = Clock::now();
+
+    std::uint32_t width, height;
+    window_get_framebuffer_size(m_Window, &width, &height);
+
+    if (width != m_Width || height != m_Height) {
+        m_Width = width;
+        m_Height = height;
+        m_ResizePending = true;
+    }
+
+    // a full queue means the render thread is stalled; the newest size goes out once it
+    // drains, intermediate ones are dropped
+    if (m_ResizePending && m_Events.Push({ WindowEventType::Resize, m_Width, m_Height })) {
+        m_ResizePending = false;
+    }
+
+    if (!m_CloseSent && window_is_close_requested(m_Window)) {
+        m_CloseSent = m_Events.Push({ WindowEventType::Close, 0, 0 });
+    }
+
+    state.Width = m_Width;
+    state.Height = m_Height;
+    m_State.Publish(state);
+
+    std::lock_guard lock(m_CallbackMutex);
+    if (m_SampleCallback) {
+        m_SampleCallback(state);
+    }
+}
+
+void InputThread::CopyToBackbuffer(const image_t* color) {
+    // fetched here rather than kept: the backbuffer is reallocated by the poll that resizes it
+    image_t* backbuffer = window_get_backbuffer(m_Window);
+    if (backbuffer == nullptr) {
+        return;
+    }
+
+    std::uint32_t width = std::min(color->width, backbuffer->width);
+    std::uint32_t height = std::min(color->height, backbuffer->height);
+
+    for (std::uint32_t y = 0; y < height; y++) {
+        memcpy(&backbuffer->data[(std::size_t)y * backbuffer->width],
+               &color->data[(std::size_t)y * color->width], width * sizeof(image_pixel));
+    }
+}
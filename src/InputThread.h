@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#include <cstdint>
+
+extern "C" {
+#include <graphics/window.h>
+#include <graphics/image.h>
+}
+
+#include "LateLatch.h"
+#include "SpscQueue.h"
+
+enum class WindowEventType {
+    Resize,
+    Close,
+};
+
+struct WindowEvent {
+    WindowEventType Type;
+
+    // new framebuffer size, for Resize
+    std::uint32_t Width, Height;
+};
+
+// what the window looked like at the latest poll
+struct InputState {
+    std::chrono::high_resolution_clock::time_point SampledAt;
+    std::uint32_t Width, Height;
+};
+
+// the window's side of a window thread / render thread split. Run belongs on the thread that
+// created the window, which most backends require for polling; it keeps polling while a frame
+// renders on another thread, so a long frame no longer holds back event processing. resize and
+// close requests go to the render thread through a lock-free queue it drains at frame start; the
+// latest input state is published through a latch. the render thread never touches the window's
+// backbuffer, which a poll may reallocate: it renders into images of its own and hands each
+// finished frame to Present. resizes coalesce while the queue is full, and close is never lost
+class InputThread {
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    // runs on the window thread right after each poll, with the state it produced
+    using SampleCallback = std::function<void(const InputState& state)>;
+
+    InputThread(window_t* window,
+                std::chrono::microseconds interval = std::chrono::microseconds(1000));
+    ~InputThread() = default;
+
+    InputThread(const InputThread&) = delete;
+    InputThread& operator=(const InputThread&) = delete;
+
+    // window thread only. polls and presents until Stop
+    void Run();
+
+    // any thread. Run returns once it has noticed
+    void Stop();
+
+    // any thread. how long the window thread waits for a frame to present before it polls again,
+    // which bounds how stale the input state gets. raise it while nothing renders, so an idle
+    // window does not wake the thread every millisecond; a shorter one applies right away
+    void SetInterval(std::chrono::microseconds interval);
+    std::chrono::microseconds GetInterval();
+
+    // render thread only. copies color into the backbuffer on the window thread, clipped to the
+    // smaller of the two sizes, and swaps. blocks until the window thread has done so
+    void Present(const image_t* color);
+
+    // render thread only
+    bool PopEvent(WindowEvent* event) { return m_Events.Pop(event); }
+
+    InputState GetState() const { return m_State.Get(); }
+
+    // any thread. whatever the callback publishes, e.g. a camera through a latch, is at most one
+    // poll interval old when a draw reads it. empty removes it; once this returns, the previous
+    // callback is not running and will not run again
+    void SetSampleCallback(SampleCallback callback);
+
+    // the window backend feeds imgui's io from inside window_poll. hold this from NewFrame until
+    // the frame's ui is built; polling waits for it, rasterization does not
+    std::mutex& GetImGuiMutex() { return m_ImGuiMutex; }
+
+private:
+    void Poll();
+
+    // window thread only
+    void CopyToBackbuffer(const image_t* color);
+
+    window_t* m_Window;
+
+    std::atomic<bool> m_Stop;
+    std::mutex m_ImGuiMutex;
+
+    std::mutex m_CallbackMutex;
+    SampleCallback m_SampleCallback;
+
+    // the frame waiting for the window thread, null once it was presented
+    std::mutex m_PresentMutex;
+    std::condition_variable m_PresentRequested, m_PresentDone;
+    const image_t* m_PendingFrame;
+
+    // guarded by m_PresentMutex; set means the window thread should restart its wait
+    std::chrono::microseconds m_Interval;
+    bool m_IntervalChanged;
+
+    SpscQueue<WindowEvent, 64> m_Events;
+    LateLatch<InputState> m_State;
+
+    // window thread only
+    std::uint32_t m_Width, m_Height;
+    bool m_ResizePending, m_CloseSent;
+};
+
+// installs a sample callback for the lifetime of the scope, so it cannot outlive what it captures
+class SampleCallbackScope {
+public:
+    SampleCallbackScope(InputThread& input, InputThread::SampleCallback callback) : m_Input(input) {
+        m_Input.SetSampleCallback(std::move(callback));
+    }
+
+    ~SampleCallbackScope() { m_Input.SetSampleCallback(nullptr); }
+
+    SampleCallbackScope(const SampleCallbackScope&) = delete;
+    SampleCallbackScope& operator=(const SampleCallbackScope&) = delete;
+
+private:
+    InputThread& m_Input;
+};
@@ -0,0 +1,58 @@
+#include "LateLatch.h"
+
+#include <algorithm>
+#include <thread>
+
+#include <cstring>
+
+UniformLatch::UniformLatch(std::size_t size) {
+    m_Size = size;
+    m_Sequence.store(0, std::memory_order_relaxed);
+
+    for (auto& word : m_Words) {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
+void UniformLatch::Write(const void* data) {
+    std::uint64_t sequence = m_Sequence.load(std::memory_order_relaxed);
+    m_Sequence.store(sequence + 1, std::memory_order_relaxed);
+
+    // readers that see the new words also see the odd sequence
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::size_t wordCount = (m_Size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+    for (std::size_t i = 0; i < wordCount; i++) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, (const std::uint8_t*)data + i * sizeof(word),
+                    std::min(sizeof(word), m_Size - i * sizeof(word)));
+
+        m_Words[i].store(word, std::memory_order_relaxed);
+    }
+
+    m_Sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void UniformLatch::Read(void* destination) const {
+    std::size_t wordCount = (m_Size + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+    std::uint64_t words[s_WordCount];
+
+    while (true) {
+        std::uint64_t before = m_Sequence.load(std::memory_order_acquire);
+        if (before % 2 != 0) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        for (std::size_t i = 0; i < wordCount; i++) {
+            words[i] = m_Words[i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_Sequence.load(std::memory_order_relaxed) == before) {
+            break;
+        }
+    }
+
+    std::memcpy(destination, words, m_Size);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <type_traits>
+
+#include <cstddef>
+#include <cstdint>
+
+// a uniform block another thread can replace at any time. readers always see one whole published
+// block: writes go through a sequence lock, so neither side ever waits on a mutex. the rasterizer
+// reads it right before each draw it is bound to (Rasterizer::BeginLateLatch), so a draw picks up
+// a camera published while earlier work was still running. one publishing thread at a time
+class UniformLatch {
+public:
+    static constexpr std::size_t MaxSize = 256;
+
+    UniformLatch(std::size_t size);
+    ~UniformLatch() = default;
+
+    UniformLatch(const UniformLatch&) = delete;
+    UniformLatch& operator=(const UniformLatch&) = delete;
+
+    std::size_t GetSize() const { return m_Size; }
+
+    // how many blocks were published so far
+    std::uint64_t GetVersion() const { return m_Sequence.load(std::memory_order_acquire) / 2; }
+
+    void Write(const void* data);
+
+    // copies the latest complete block; retries while a write is in progress
+    void Read(void* destination) const;
+
+private:
+    static constexpr std::size_t s_WordCount = MaxSize / sizeof(std::uint64_t);
+
+    std::size_t m_Size;
+
+    // odd while a write is in progress
+    std::atomic<std::uint64_t> m_Sequence;
+
+    // atomic words rather than plain bytes, so a torn read is a retry and not a data race
+    std::atomic<std::uint64_t> m_Words[s_WordCount];
+};
+
+template <typename T>
+class LateLatch : public UniformLatch {
+public:
+    static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= MaxSize);
+
+    LateLatch() : UniformLatch(sizeof(T)) {}
+    LateLatch(const T& initial) : UniformLatch(sizeof(T)) { Publish(initial); }
+
+    void Publish(const T& value) { Write(&value); }
+
+    T Get() const {
+        T value;
+        Read(&value);
+
+        return value;
+    }
+};
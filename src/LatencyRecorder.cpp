@@ -0,0 +1,80 @@
+#include "LatencyRecorder.h"
+
+#include <algorithm>
+#include <cmath>
+
+const char* GetLatencySegmentName(LatencyPoint end) {
+    switch (end) {
+    case LatencyPoint::UniformsUpdated:
+        return "Input to uniforms";
+    case LatencyPoint::RasterComplete:
+        return "Uniforms to raster complete";
+    case LatencyPoint::Presented:
+        return "Raster complete to present";
+    default:
+        return "Input";
+    }
+}
+
+LatencyRecorder::LatencyRecorder(std::uint32_t windowSize) {
+    m_Frames.resize(windowSize);
+    m_Next = m_Count = 0;
+
+    m_Last = m_Average = {};
+    std::fill_n(m_Sums, s_LatencyPointCount, 0.0);
+
+    m_Sorted.reserve(windowSize);
+}
+
+void LatencyRecorder::EndFrame() {
+    Frame frame;
+    frame.Milliseconds[0] = 0.0;
+
+    auto input = m_Points[0];
+    auto previous = input;
+
+    for (std::uint32_t i = 1; i < s_LatencyPointCount; i++) {
+        // a point left over from an earlier frame is treated as not reached
+        auto point = std::max(m_Points[i], previous);
+
+        frame.Milliseconds[i] = std::chrono::duration<double, std::milli>(point - input).count();
+        previous = point;
+    }
+
+    auto windowSize = (std::uint32_t)m_Frames.size();
+    auto& slot = m_Frames[m_Next];
+
+    if (m_Count == windowSize) {
+        for (std::uint32_t i = 0; i < s_LatencyPointCount; i++) {
+            m_Sums[i] -= slot.Milliseconds[i];
+        }
+    } else {
+        m_Count++;
+    }
+
+    slot = frame;
+    m_Next = (m_Next + 1) % windowSize;
+
+    for (std::uint32_t i = 0; i < s_LatencyPointCount; i++) {
+        m_Sums[i] += frame.Milliseconds[i];
+        m_Average.Milliseconds[i] = m_Sums[i] / m_Count;
+    }
+
+    m_Last = frame;
+}
+
+double LatencyRecorder::GetTotalPercentile(double percentile) const {
+    if (m_Count == 0) {
+        return 0.0;
+    }
+
+    m_Sorted.clear();
+    for (std::uint32_t i = 0; i < m_Count; i++) {
+        m_Sorted.push_back(m_Frames[i].GetTotal());
+    }
+
+    std::sort(m_Sorted.begin(), m_Sorted.end());
+
+    auto rank = (std::uint32_t)std::ceil(percentile / 100.0 * m_Count);
+    return m_Sorted[std::clamp(rank, 1u, m_Count) - 1];
+}
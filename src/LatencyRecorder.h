@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include <cstdint>
+
+// points along one frame's path from input to the screen, in the order they happen
+enum class LatencyPoint {
+    // the input thread's latest poll before the frame started; input for this frame is sampled
+    InputSampled,
+
+    // the scene draw is about to latch the newest camera the input thread published
+    UniformsUpdated,
+
+    // the last rasterizer call of the frame returned
+    RasterComplete,
+
+    // SwapBuffers returned. the image reaches the display some time after this, depending on
+    // the window system's present mode
+    Presented,
+};
+
+static constexpr std::uint32_t s_LatencyPointCount = 4;
+
+// the segment ending at a point; the first point has none
+const char* GetLatencySegmentName(LatencyPoint end);
+
+// per-frame input-to-present latency chain, with averages and a tail over a rolling window
+class LatencyRecorder {
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    struct Frame {
+        // milliseconds from InputSampled to each point; index 0 is always 0
+        double Milliseconds[s_LatencyPointCount];
+
+        double GetTotal() const { return Milliseconds[s_LatencyPointCount - 1]; }
+    };
+
+    LatencyRecorder(std::uint32_t windowSize = 1024);
+    ~LatencyRecorder() = default;
+
+    LatencyRecorder(const LatencyRecorder&) = delete;
+    LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+    void Mark(LatencyPoint point) { Mark(point, Clock::now()); }
+    void Mark(LatencyPoint point, Clock::time_point time) { m_Points[(std::uint32_t)point] = time; }
+
+    // closes the frame once Presented was marked. points that were not marked this frame count
+    // as reached at the previous point
+    void EndFrame();
+
+    std::uint32_t GetFrameCount() const { return m_Count; }
+
+    const Frame& GetLastFrame() const { return m_Last; }
+
+    // averages over the window, in the same form as a frame
+    const Frame& GetAverage() const { return m_Average; }
+
+    // nearest-rank percentile of the total latency over the window
+    double GetTotalPercentile(double percentile) const;
+
+private:
+    Clock::time_point m_Points[s_LatencyPointCount];
+
+    std::vector<Frame> m_Frames;
+    std::uint32_t m_Next, m_Count;
+
+    Frame m_Last, m_Average;
+    double m_Sums[s_LatencyPointCount];
+
+    mutable std::vector<double> m_Sorted;
+};
@@ -0,0 +1,101 @@
+#include "MemoryBudget.h"
+
+#include <fstream>
+#include <string>
+
+#include <cstdlib>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// the process degrades every category once it is this close to the container limit, leaving
+// headroom for the allocations nothing here accounts for
+static constexpr double s_PressureThreshold = 0.9;
+
+static constexpr std::size_t s_MiB = 1024 * 1024;
+
+const char* GetMemoryCategoryName(MemoryCategory category) {
+    switch (category) {
+    case MemoryCategory::Attachments:
+        return "Attachments";
+    case MemoryCategory::PostProcess:
+        return "Post-processing";
+    default:
+        return "Unknown";
+    }
+}
+
+// cgroup v2 first, then v1. v1 reports "no limit" as a huge number rather than "max"
+static std::size_t ReadContainerLimit() {
+    static const char* const paths[] = { "/sys/fs/cgroup/memory.max",
+                                         "/sys/fs/cgroup/memory/memory.limit_in_bytes" };
+
+    for (const char* path : paths) {
+        std::ifstream stream(path);
+
+        std::string value;
+        if (!(stream >> value) || value == "max") {
+            continue;
+        }
+
+        auto limit = (std::size_t)std::strtoull(value.c_str(), nullptr, 10);
+        return limit < ((std::size_t)1 << 60) ? limit : 0;
+    }
+
+    return 0;
+}
+
+// statm over open and read rather than a stream, so polling it every frame does not allocate
+static std::size_t ReadResidentBytes() {
+#ifdef __linux__
+    int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+
+    char buffer[128];
+    ssize_t size = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+
+    if (size <= 0) {
+        return 0;
+    }
+
+    // total program size, then resident pages
+    buffer[size] = '\0';
+
+    char* end;
+    std::strtoull(buffer, &end, 10);
+    std::size_t pages = std::strtoull(end, nullptr, 10);
+
+    return pages * (std::size_t)sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+MemoryBudget::MemoryBudget() {
+    m_Budgets[(std::uint32_t)MemoryCategory::Attachments] = 0;
+    m_Budgets[(std::uint32_t)MemoryCategory::PostProcess] = 64 * s_MiB;
+
+    for (auto& usage : m_Usage) {
+        usage = 0;
+    }
+
+    m_ResidentBytes = 0;
+    m_ContainerLimit = ReadContainerLimit();
+}
+
+void MemoryBudget::Update() { m_ResidentBytes = ReadResidentBytes(); }
+
+bool MemoryBudget::IsUnderPressure() const {
+    return m_ContainerLimit > 0 &&
+           (double)m_ResidentBytes > (double)m_ContainerLimit * s_PressureThreshold;
+}
+
+bool MemoryBudget::IsOverBudget(MemoryCategory category) const {
+    std::size_t budget = GetBudget(category);
+    return IsUnderPressure() || (budget > 0 && GetUsage(category) > budget);
+}
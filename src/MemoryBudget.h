@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class MemoryCategory {
+    // the frame's color and depth attachments from image_allocate. only reported: their size
+    // follows the window, so there is nothing to degrade to
+    Attachments,
+
+    // bloom chain and post-processing scratch
+    PostProcess,
+};
+
+static constexpr std::uint32_t s_MemoryCategoryCount = 2;
+
+const char* GetMemoryCategoryName(MemoryCategory category);
+
+// per-category byte budgets for memory the renderer owns, checked against usage the owners
+// report each frame. the rasterizer's internal arenas are not visible from here; they show up
+// in the process's resident size, which is compared against the container's memory limit
+class MemoryBudget {
+public:
+    MemoryBudget();
+    ~MemoryBudget() = default;
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+    // 0 means unlimited
+    void SetBudget(MemoryCategory category, std::size_t bytes) {
+        m_Budgets[(std::uint32_t)category] = bytes;
+    }
+
+    std::size_t GetBudget(MemoryCategory category) const {
+        return m_Budgets[(std::uint32_t)category];
+    }
+
+    void SetUsage(MemoryCategory category, std::size_t bytes) {
+        m_Usage[(std::uint32_t)category] = bytes;
+    }
+
+    std::size_t GetUsage(MemoryCategory category) const {
+        return m_Usage[(std::uint32_t)category];
+    }
+
+    // re-reads the resident size. call once per frame after the usage was reported
+    void Update();
+
+    // over its own budget, or the whole process is close to the container limit
+    bool IsOverBudget(MemoryCategory category) const;
+
+    bool IsUnderPressure() const;
+
+    std::size_t GetResidentBytes() const { return m_ResidentBytes; }
+
+    // the cgroup memory limit, read once at construction; 0 when unlimited or unknown
+    std::size_t GetContainerLimit() const { return m_ContainerLimit; }
+
+private:
+    std::size_t m_Budgets[s_MemoryCategoryCount];
+    std::size_t m_Usage[s_MemoryCategoryCount];
+
+    std::size_t m_ResidentBytes;
+    std::size_t m_ContainerLimit;
+};
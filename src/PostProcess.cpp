@@ -0,0 +1,678 @@
+#include "PostProcess.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+static constexpr std::uint32_t s_RowsPerJob = 16;
+
+// fxaa samples up to half its span away from the center, plus one texel for filtering
+static constexpr float s_FXAASpanMax = 8.f;
+static constexpr std::uint32_t s_FXAAApron = (std::uint32_t)(s_FXAASpanMax / 2.f) + 1;
+
+// the fused composite and fxaa run per band of rows; a band plus its apron stays resident in a
+// per-thread buffer instead of going through a full-frame intermediate. bands are sized so that
+// buffer takes half the l2, leaving the rest for the row scratch and the bloom rows. narrow bands
+// recomposite their aprons more often, so they never get shorter than this
+static constexpr std::uint32_t s_MinBandHeight = 8;
+
+// when the cache size is unknown
+static constexpr std::size_t s_DefaultL2Bytes = 1024 * 1024;
+
+static std::size_t GetBandCacheBytes() {
+    static const std::size_t bytes = []() {
+        long l2 = -1;
+#if defined(__linux__) && defined(_SC_LEVEL2_CACHE_SIZE)
+        l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+
+        return (l2 > 0 ? (std::size_t)l2 : s_DefaultL2Bytes) / 2;
+    }();
+
+    return bytes;
+}
+
+static std::uint32_t GetBandHeight(std::uint32_t width) {
+    std::size_t rows = GetBandCacheBytes() / ((std::size_t)width * sizeof(std::uint32_t));
+    rows = rows > s_FXAAApron * 2 ? rows - s_FXAAApron * 2 : 0;
+
+    return (std::uint32_t)std::max<std::size_t>(rows, s_MinBandHeight);
+}
+static constexpr std::uint32_t s_MaxBloomLevels = 5;
+static constexpr std::uint32_t s_MinBloomSize = 4;
+
+template <typename T, typename Allocator>
+static T* GrowScratch(std::vector<T, Allocator>& scratch, std::size_t count) {
+    if (scratch.size() < count) {
+        scratch.resize(count);
+    }
+
+    return scratch.data();
+}
+
+template <typename T, typename Allocator>
+static void FreeScratch(std::vector<T, Allocator>& scratch) {
+    std::vector<T, Allocator>().swap(scratch);
+}
+
+static std::uint32_t* GetPixels(const image_t* image) { return (std::uint32_t*)image->data; }
+
+// 8-bit channels are treated as gamma 2 rather than exact srgb; squaring and sqrt vectorize,
+// pow does not
+static void UnpackRow(const std::uint32_t* pixels, std::uint32_t count, float* r, float* g,
+                      float* b) {
+    static constexpr float scale = 1.f / 255.f;
+
+    for (std::uint32_t i = 0; i < count; i++) {
+        std::uint32_t pixel = pixels[i];
+
+        float red = (float)(pixel >> 24) * scale;
+        float green = (float)((pixel >> 16) & 0xFF) * scale;
+        float blue = (float)((pixel >> 8) & 0xFF) * scale;
+
+        r[i] = red * red;
+        g[i] = green * green;
+        b[i] = blue * blue;
+    }
+}
+
+// min/max rather than std::clamp; the latter keeps a branch that stops vectorization
+static float Saturate(float value) { return std::min(std::max(value, 0.f), 1.f); }
+
+static std::uint32_t PackChannel(float value) {
+    return (std::uint32_t)(Saturate(value) * 255.f + 0.5f);
+}
+
+static float Luma(float r, float g, float b) { return 0.299f * r + 0.587f * g + 0.114f * b; }
+
+using BilinearTap = PostProcessor::BilinearTap;
+
+static BilinearTap ComputeTap(float coordinate, std::uint32_t size) {
+    coordinate = std::clamp(coordinate, 0.f, (float)(size - 1));
+
+    BilinearTap tap;
+    tap.Index0 = (std::uint32_t)coordinate;
+    tap.Index1 = std::min(tap.Index0 + 1, size - 1);
+    tap.Weight = coordinate - (float)tap.Index0;
+
+    return tap;
+}
+
+static float SampleRows(const float* row0, const float* row1, const BilinearTap& x,
+                        float weightY) {
+    float top = row0[x.Index0] + (row0[x.Index1] - row0[x.Index0]) * x.Weight;
+    float bottom = row1[x.Index0] + (row1[x.Index1] - row1[x.Index0]) * x.Weight;
+
+    return top + (bottom - top) * weightY;
+}
+
+// scratch for planeCount planes of width pixels each
+static std::size_t GetPlaneFloats(std::uint32_t width, std::uint32_t planeCount) {
+    return (std::size_t)GetPaddedWidth(width) * planeCount;
+}
+
+// hands out one plane per channel from a row's scratch space. planes are padded like ColorImage
+// rows and start on a cache line, so kernels can run over the padded width without a tail
+static void CarvePlanes(float*& scratch, std::uint32_t width, float** planes) {
+    for (std::uint32_t c = 0; c < 3; c++) {
+        planes[c] = scratch;
+        scratch += GetPaddedWidth(width);
+    }
+}
+
+// whole padded rows; the padding converts along with the pixels
+static void UnpackImageRow(const ColorImage& image, std::uint32_t y, float* const* planes) {
+    UnpackColorRow(image.Format, image.GetRow(y), GetPaddedWidth(image.Width), planes[0],
+                   planes[1], planes[2]);
+}
+
+static void PackImageRow(ColorImage& image, std::uint32_t y, const float* const* planes) {
+    PackColorRow(image.Format, planes[0], planes[1], planes[2], GetPaddedWidth(image.Width),
+                 image.GetRow(y));
+}
+
+// narkowicz's fit of the aces filmic curve
+static float TonemapACES(float x) {
+    static constexpr float a = 2.51f;
+    static constexpr float b = 0.03f;
+    static constexpr float c = 2.43f;
+    static constexpr float d = 0.59f;
+    static constexpr float e = 0.14f;
+
+    return Saturate((x * (a * x + b)) / (x * (c * x + d) + e));
+}
+
+PostProcessor::PostProcessor(const std::shared_ptr<WorkerPool>& pool) {
+    m_Pool = pool;
+    m_Width = m_Height = 0;
+    m_BandHeight = s_MinBandHeight;
+
+    m_Bloom = false;
+    m_BloomFormat = ColorFormat::R11G11B10F;
+    m_BloomDownscale = 0;
+    m_FXAA = false;
+
+    m_Scratch.resize(m_Pool->GetThreadCount());
+}
+
+void PostProcessor::Process(image_t* target, const PostProcessSettings& settings) {
+    // e.g. a minimized window
+    if (target == nullptr || target->width == 0 || target->height == 0) {
+        return;
+    }
+
+    bool perPixel = settings.Bloom || settings.Tonemap || settings.ColorGrading;
+    if (!perPixel && !settings.FXAA) {
+        Release();
+        return;
+    }
+
+    Resize(target->width, target->height, settings);
+
+    if (settings.Bloom && !m_BloomChain.empty()) {
+        BrightPass(target, settings.BloomThreshold);
+
+        for (std::size_t i = 1; i < m_BloomChain.size(); i++) {
+            Downsample(m_BloomChain[i - 1], m_BloomChain[i]);
+        }
+
+        for (std::size_t i = m_BloomChain.size() - 1; i > 0; i--) {
+            UpsampleAdd(m_BloomChain[i], m_BloomChain[i - 1]);
+        }
+    }
+
+    if (settings.FXAA) {
+        CompositeAndFXAA(target, settings);
+    } else {
+        Composite(target, settings);
+    }
+}
+
+std::size_t PostProcessor::GetMemoryUsage() const {
+    std::size_t bytes = m_BandEdges.capacity() * sizeof(std::uint32_t);
+    bytes += m_ColumnTaps.capacity() * sizeof(BilinearTap);
+
+    for (const auto& scratch : m_Scratch) {
+        bytes += scratch.Row.capacity() * sizeof(float);
+        bytes += scratch.Band.capacity() * sizeof(std::uint32_t);
+    }
+
+    for (const auto& level : m_BloomChain) {
+        bytes += level.Data.capacity();
+    }
+
+    return bytes;
+}
+
+void PostProcessor::Resize(std::uint32_t width, std::uint32_t height,
+                           const PostProcessSettings& settings) {
+    std::uint32_t downscale = std::max(settings.BloomDownscale, 2u);
+    if (width == m_Width && height == m_Height && settings.Bloom == m_Bloom &&
+        settings.BloomFormat == m_BloomFormat && downscale == m_BloomDownscale &&
+        settings.FXAA == m_FXAA) {
+        return;
+    }
+
+    // sized for the old settings, e.g. rows as wide as a bloom level that no longer exists or
+    // bands for fxaa that was turned off; the next passes grow back what they still need
+    for (auto& scratch : m_Scratch) {
+        FreeScratch(scratch.Row);
+        FreeScratch(scratch.Band);
+    }
+
+    if (width != m_Width || height != m_Height) {
+        m_BandHeight = GetBandHeight(width);
+
+        std::uint32_t bandCount = (height + m_BandHeight - 1) / m_BandHeight;
+        m_BandEdges.resize((std::size_t)(bandCount - 1) * s_FXAAApron * 2 * width);
+    }
+
+    m_Width = width;
+    m_Height = height;
+    m_Bloom = settings.Bloom;
+    m_BloomFormat = settings.BloomFormat;
+    m_BloomDownscale = downscale;
+    m_FXAA = settings.FXAA;
+
+    // clear alone keeps the levels' memory around through the vector's capacity
+    m_BloomChain.clear();
+    m_BloomChain.shrink_to_fit();
+
+    if (!m_Bloom) {
+        return;
+    }
+
+    std::uint32_t levelWidth = width / downscale;
+    std::uint32_t levelHeight = height / downscale;
+
+    while (m_BloomChain.size() < s_MaxBloomLevels && levelWidth >= s_MinBloomSize &&
+           levelHeight >= s_MinBloomSize) {
+        auto& level = m_BloomChain.emplace_back();
+        level.Allocate(levelWidth, levelHeight, m_BloomFormat);
+
+        levelWidth /= 2;
+        levelHeight /= 2;
+    }
+}
+
+void PostProcessor::Release() {
+    if (m_Width == 0) {
+        return;
+    }
+
+    m_Width = m_Height = 0;
+    m_Bloom = m_FXAA = false;
+
+    m_BloomChain.clear();
+    m_BloomChain.shrink_to_fit();
+    FreeScratch(m_BandEdges);
+    FreeScratch(m_ColumnTaps);
+
+    for (auto& scratch : m_Scratch) {
+        FreeScratch(scratch.Row);
+        FreeScratch(scratch.Band);
+    }
+}
+
+const BilinearTap* PostProcessor::ComputeColumnTaps(std::uint32_t width, std::uint32_t sourceWidth,
+                                                    float scale) {
+    if (m_ColumnTaps.size() < width) {
+        m_ColumnTaps.resize(width);
+    }
+
+    for (std::uint32_t x = 0; x < width; x++) {
+        m_ColumnTaps[x] = ComputeTap(((float)x + 0.5f) * scale - 0.5f, sourceWidth);
+    }
+
+    return m_ColumnTaps.data();
+}
+
+template <typename Func>
+void PostProcessor::ForEachRowBlock(std::uint32_t height, const Func& func) {
+    std::uint32_t blockCount = (height + s_RowsPerJob - 1) / s_RowsPerJob;
+
+    m_Pool->ParallelForThreads(blockCount, [&](std::uint32_t block, std::uint32_t thread) {
+        std::uint32_t begin = block * s_RowsPerJob;
+        std::uint32_t end = std::min(begin + s_RowsPerJob, height);
+
+        for (std::uint32_t y = begin; y < end; y++) {
+            func(y, thread);
+        }
+    });
+}
+
+void PostProcessor::BrightPass(const image_t* source, float threshold) {
+    auto& destination = m_BloomChain[0];
+    const std::uint32_t* pixels = GetPixels(source);
+
+    std::uint32_t sourceWidth = source->width;
+    std::uint32_t sourceHeight = source->height;
+    std::uint32_t downscale = m_BloomDownscale;
+    std::uint32_t lanes = GetPaddedWidth(destination.Width);
+
+    ForEachRowBlock(destination.Height, [&](std::uint32_t y, std::uint32_t thread) {
+        std::size_t floats = GetPlaneFloats(sourceWidth, 6) + GetPlaneFloats(destination.Width, 3);
+        float* scratch = GrowScratch(m_Scratch[thread].Row, floats);
+
+        float *top[3], *bottom[3], *out[3];
+        CarvePlanes(scratch, sourceWidth, top);
+        CarvePlanes(scratch, sourceWidth, bottom);
+        CarvePlanes(scratch, destination.Width, out);
+
+        // a 2x2 box at the default downscale; larger factors sample the same four taps spread
+        // over the footprint instead of reading every source pixel
+        std::uint32_t y0 = y * downscale;
+        std::uint32_t y1 = std::min(y0 + downscale / 2, sourceHeight - 1);
+
+        UnpackRow(pixels + (std::size_t)y0 * sourceWidth, sourceWidth, top[0], top[1], top[2]);
+        UnpackRow(pixels + (std::size_t)y1 * sourceWidth, sourceWidth, bottom[0], bottom[1],
+                  bottom[2]);
+
+        // the source rows come from the rasterizer unpadded; padding lanes read the last pixel
+        for (std::uint32_t c = 0; c < 3; c++) {
+            for (std::uint32_t x = 0; x < lanes; x++) {
+                std::uint32_t x0 = std::min(x * downscale, sourceWidth - 1);
+                std::uint32_t x1 = std::min(x0 + downscale / 2, sourceWidth - 1);
+
+                out[c][x] = (top[c][x0] + top[c][x1] + bottom[c][x0] + bottom[c][x1]) * 0.25f;
+            }
+        }
+
+        // soft threshold: keep the part of each pixel brighter than the threshold, preserving hue
+        for (std::uint32_t x = 0; x < lanes; x++) {
+            float luma = Luma(out[0][x], out[1][x], out[2][x]);
+            float weight = std::max(luma - threshold, 0.f) / std::max(luma, 1e-4f);
+
+            out[0][x] *= weight;
+            out[1][x] *= weight;
+            out[2][x] *= weight;
+        }
+
+        PackImageRow(destination, y, out);
+    });
+}
+
+void PostProcessor::Downsample(const ColorImage& source, ColorImage& destination) {
+    std::uint32_t lanes = GetPaddedWidth(destination.Width);
+
+    ForEachRowBlock(destination.Height, [&](std::uint32_t y, std::uint32_t thread) {
+        std::size_t floats = GetPlaneFloats(source.Width, 6) + GetPlaneFloats(destination.Width, 3);
+        float* scratch = GrowScratch(m_Scratch[thread].Row, floats);
+
+        float *top[3], *bottom[3], *out[3];
+        CarvePlanes(scratch, source.Width, top);
+        CarvePlanes(scratch, source.Width, bottom);
+        CarvePlanes(scratch, destination.Width, out);
+
+        std::uint32_t y0 = y * 2;
+        std::uint32_t y1 = std::min(y0 + 1, source.Height - 1);
+
+        UnpackImageRow(source, y0, top);
+        UnpackImageRow(source, y1, bottom);
+
+        for (std::uint32_t c = 0; c < 3; c++) {
+            for (std::uint32_t x = 0; x < lanes; x++) {
+                std::uint32_t x0 = std::min(x * 2, source.Width - 1);
+                std::uint32_t x1 = std::min(x0 + 1, source.Width - 1);
+
+                out[c][x] = (top[c][x0] + top[c][x1] + bottom[c][x0] + bottom[c][x1]) * 0.25f;
+            }
+        }
+
+        PackImageRow(destination, y, out);
+    });
+}
+
+void PostProcessor::UpsampleAdd(const ColorImage& source, ColorImage& destination) {
+    float scaleX = (float)source.Width / (float)destination.Width;
+    float scaleY = (float)source.Height / (float)destination.Height;
+
+    std::uint32_t lanes = GetPaddedWidth(destination.Width);
+    const BilinearTap* columnTaps = ComputeColumnTaps(lanes, source.Width, scaleX);
+
+    ForEachRowBlock(destination.Height, [&](std::uint32_t y, std::uint32_t thread) {
+        std::size_t floats = GetPlaneFloats(source.Width, 6) + GetPlaneFloats(destination.Width, 3);
+        float* scratch = GrowScratch(m_Scratch[thread].Row, floats);
+
+        float *top[3], *bottom[3], *out[3];
+        CarvePlanes(scratch, source.Width, top);
+        CarvePlanes(scratch, source.Width, bottom);
+        CarvePlanes(scratch, destination.Width, out);
+
+        BilinearTap tapY = ComputeTap(((float)y + 0.5f) * scaleY - 0.5f, source.Height);
+        UnpackImageRow(source, tapY.Index0, top);
+        UnpackImageRow(source, tapY.Index1, bottom);
+        UnpackImageRow(destination, y, out);
+
+        for (std::uint32_t c = 0; c < 3; c++) {
+            for (std::uint32_t x = 0; x < lanes; x++) {
+                out[c][x] += SampleRows(top[c], bottom[c], columnTaps[x], tapY.Weight);
+            }
+        }
+
+        PackImageRow(destination, y, out);
+    });
+}
+
+const BilinearTap* PostProcessor::PrepareComposite(const PostProcessSettings& settings) {
+    if (!settings.Bloom || m_BloomChain.empty()) {
+        return nullptr;
+    }
+
+    float scaleX = (float)m_BloomChain[0].Width / (float)m_Width;
+    return ComputeColumnTaps(GetPaddedWidth(m_Width), m_BloomChain[0].Width, scaleX);
+}
+
+void PostProcessor::Composite(image_t* target, const PostProcessSettings& settings) {
+    std::uint32_t* pixels = GetPixels(target);
+    const BilinearTap* columnTaps = PrepareComposite(settings);
+
+    ForEachRowBlock(m_Height, [&](std::uint32_t y, std::uint32_t thread) {
+        std::uint32_t* row = pixels + (std::size_t)y * m_Width;
+        CompositeRow(thread, row, y, row, false, settings, columnTaps);
+    });
+}
+
+void PostProcessor::CompositeAndFXAA(image_t* target, const PostProcessSettings& settings) {
+    std::uint32_t* pixels = GetPixels(target);
+    const BilinearTap* columnTaps = PrepareComposite(settings);
+
+    std::uint32_t width = m_Width;
+    std::uint32_t height = m_Height;
+
+    std::uint32_t bandHeight = m_BandHeight;
+    std::uint32_t bandCount = (height + bandHeight - 1) / bandHeight;
+    std::uint32_t edgeRows = s_FXAAApron * 2;
+    std::uint32_t* edges = m_BandEdges.data();
+
+    // bands write their results in place, over rows that the neighbouring bands read as their
+    // apron. the source rows around each boundary are saved first; bands read their aprons from
+    // this copy and only ever touch their own rows in the target
+    m_Pool->ParallelFor(bandCount - 1, [&](std::uint32_t boundary) {
+        std::uint32_t y = (boundary + 1) * bandHeight - s_FXAAApron;
+
+        for (std::uint32_t i = 0; i < edgeRows && y + i < height; i++) {
+            std::size_t edgeOffset = ((std::size_t)boundary * edgeRows + i) * width;
+            std::size_t rowOffset = (std::size_t)(y + i) * width;
+
+            std::copy(pixels + rowOffset, pixels + rowOffset + width, edges + edgeOffset);
+        }
+    });
+
+    m_Pool->ParallelForThreads(bandCount, [&](std::uint32_t band, std::uint32_t thread) {
+        std::uint32_t begin = band * bandHeight;
+        std::uint32_t end = std::min(begin + bandHeight, height);
+        std::uint32_t top = begin >= s_FXAAApron ? begin - s_FXAAApron : 0;
+        std::uint32_t bottom = std::min(end + s_FXAAApron, height);
+
+        std::uint32_t* local =
+            GrowScratch(m_Scratch[thread].Band, (std::size_t)(bottom - top) * width);
+        for (std::uint32_t y = top; y < bottom; y++) {
+            const std::uint32_t* source;
+            if (y < begin) {
+                std::uint32_t edgeRow = y - (begin - s_FXAAApron);
+                source = edges + ((std::size_t)(band - 1) * edgeRows + edgeRow) * width;
+            } else if (y >= end) {
+                std::uint32_t edgeRow = s_FXAAApron + (y - end);
+                source = edges + ((std::size_t)band * edgeRows + edgeRow) * width;
+            } else {
+                source = pixels + (std::size_t)y * width;
+            }
+
+            CompositeRow(thread, source, y, local + (std::size_t)(y - top) * width, true,
+                         settings, columnTaps);
+        }
+
+        for (std::uint32_t y = begin; y < end; y++) {
+            FXAARow(local, top, bottom, y, pixels + (std::size_t)y * width);
+        }
+    });
+}
+
+void PostProcessor::CompositeRow(std::uint32_t thread, const std::uint32_t* source, std::uint32_t y,
+                                 std::uint32_t* destination, bool lumaInAlpha,
+                                 const PostProcessSettings& settings,
+                                 const BilinearTap* columnTaps) {
+    std::uint32_t width = m_Width;
+    std::uint32_t bloomWidth = columnTaps != nullptr ? m_BloomChain[0].Width : 0;
+    float* scratch = GrowScratch(m_Scratch[thread].Row,
+                                 GetPlaneFloats(width, 3) + GetPlaneFloats(bloomWidth, 6));
+
+    // the planar passes run over the padded width; only width pixels go back to the target
+    std::uint32_t lanes = GetPaddedWidth(width);
+
+    float* channels[3];
+    CarvePlanes(scratch, width, channels);
+
+    float* r = channels[0];
+    float* g = channels[1];
+    float* b = channels[2];
+
+    UnpackRow(source, width, r, g, b);
+
+    if (columnTaps != nullptr) {
+        const auto& level = m_BloomChain[0];
+        float scaleY = (float)level.Height / (float)m_Height;
+
+        float *top[3], *bottom[3];
+        CarvePlanes(scratch, bloomWidth, top);
+        CarvePlanes(scratch, bloomWidth, bottom);
+
+        BilinearTap tapY = ComputeTap(((float)y + 0.5f) * scaleY - 0.5f, level.Height);
+        UnpackImageRow(level, tapY.Index0, top);
+        UnpackImageRow(level, tapY.Index1, bottom);
+
+        for (std::uint32_t c = 0; c < 3; c++) {
+            float* out = channels[c];
+
+            for (std::uint32_t x = 0; x < lanes; x++) {
+                out[x] += SampleRows(top[c], bottom[c], columnTaps[x], tapY.Weight) *
+                          settings.BloomIntensity;
+            }
+        }
+    }
+
+    if (settings.Tonemap) {
+        for (std::uint32_t x = 0; x < lanes; x++) {
+            r[x] = TonemapACES(r[x] * settings.Exposure);
+            g[x] = TonemapACES(g[x] * settings.Exposure);
+            b[x] = TonemapACES(b[x] * settings.Exposure);
+        }
+    }
+
+    // back to display space; grading operates there
+    for (std::uint32_t x = 0; x < lanes; x++) {
+        r[x] = std::sqrt(std::max(r[x], 0.f));
+        g[x] = std::sqrt(std::max(g[x], 0.f));
+        b[x] = std::sqrt(std::max(b[x], 0.f));
+    }
+
+    if (settings.ColorGrading) {
+        for (std::uint32_t x = 0; x < lanes; x++) {
+            float luma = Luma(r[x], g[x], b[x]);
+
+            r[x] = ((luma + (r[x] - luma) * settings.Saturation - 0.5f) * settings.Contrast +
+                    0.5f) *
+                   settings.Gain.x;
+
+            g[x] = ((luma + (g[x] - luma) * settings.Saturation - 0.5f) * settings.Contrast +
+                    0.5f) *
+                   settings.Gain.y;
+
+            b[x] = ((luma + (b[x] - luma) * settings.Saturation - 0.5f) * settings.Contrast +
+                    0.5f) *
+                   settings.Gain.z;
+        }
+    }
+
+    // fxaa reads luma from alpha; otherwise this is the final image and keeps its alpha
+    if (lumaInAlpha) {
+        for (std::uint32_t x = 0; x < width; x++) {
+            destination[x] = (PackChannel(r[x]) << 24) | (PackChannel(g[x]) << 16) |
+                             (PackChannel(b[x]) << 8) | PackChannel(Luma(r[x], g[x], b[x]));
+        }
+    } else {
+        for (std::uint32_t x = 0; x < width; x++) {
+            destination[x] = (PackChannel(r[x]) << 24) | (PackChannel(g[x]) << 16) |
+                             (PackChannel(b[x]) << 8) | (source[x] & 0xFF);
+        }
+    }
+}
+
+void PostProcessor::FXAARow(const std::uint32_t* band, std::uint32_t top, std::uint32_t bottom,
+                            std::uint32_t row, std::uint32_t* destination) {
+    static constexpr float edgeThreshold = 1.f / 8.f;
+    static constexpr float edgeThresholdMin = 1.f / 24.f;
+    static constexpr float reduceMul = 1.f / 8.f;
+    static constexpr float reduceMin = 1.f / 128.f;
+
+    std::uint32_t width = m_Width;
+    std::uint32_t rows = bottom - top;
+
+    // coordinates are band-relative from here on. clamping to the band is clamping to the image,
+    // since the apron covers everything fxaa can reach
+    auto lumaAt = [&](std::int32_t x, std::int32_t y) {
+        x = std::clamp(x, 0, (std::int32_t)width - 1);
+        y = std::clamp(y, 0, (std::int32_t)rows - 1);
+
+        return (float)(band[(std::size_t)y * width + x] & 0xFF) / 255.f;
+    };
+
+    auto sample = [&](float x, float y, float* rgb) {
+        BilinearTap tapX = ComputeTap(x, width);
+        BilinearTap tapY = ComputeTap(y, rows);
+
+        std::uint32_t texels[4] = {
+            band[(std::size_t)tapY.Index0 * width + tapX.Index0],
+            band[(std::size_t)tapY.Index0 * width + tapX.Index1],
+            band[(std::size_t)tapY.Index1 * width + tapX.Index0],
+            band[(std::size_t)tapY.Index1 * width + tapX.Index1],
+        };
+
+        for (std::uint32_t c = 0; c < 3; c++) {
+            std::uint32_t shift = 24 - c * 8;
+            float t0 = (float)((texels[0] >> shift) & 0xFF);
+            float t1 = (float)((texels[1] >> shift) & 0xFF);
+            float t2 = (float)((texels[2] >> shift) & 0xFF);
+            float t3 = (float)((texels[3] >> shift) & 0xFF);
+
+            float upper = t0 + (t1 - t0) * tapX.Weight;
+            float lower = t2 + (t3 - t2) * tapX.Weight;
+            rgb[c] = (upper + (lower - upper) * tapY.Weight) / 255.f;
+        }
+    };
+
+    auto y = (std::int32_t)(row - top);
+    const std::uint32_t* source = band + (std::size_t)y * width;
+
+    for (std::int32_t x = 0; x < (std::int32_t)width; x++) {
+        float lumaM = lumaAt(x, y);
+        float lumaNW = lumaAt(x - 1, y - 1);
+        float lumaNE = lumaAt(x + 1, y - 1);
+        float lumaSW = lumaAt(x - 1, y + 1);
+        float lumaSE = lumaAt(x + 1, y + 1);
+
+        float lumaMin = std::min({ lumaM, lumaNW, lumaNE, lumaSW, lumaSE });
+        float lumaMax = std::max({ lumaM, lumaNW, lumaNE, lumaSW, lumaSE });
+
+        // most pixels are not on an edge; copy them through with an opaque alpha
+        if (lumaMax - lumaMin < std::max(edgeThresholdMin, lumaMax * edgeThreshold)) {
+            destination[x] = source[x] | 0xFF;
+            continue;
+        }
+
+        float dirX = -((lumaNW + lumaNE) - (lumaSW + lumaSE));
+        float dirY = (lumaNW + lumaSW) - (lumaNE + lumaSE);
+
+        float dirReduce =
+            std::max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25f * reduceMul, reduceMin);
+        float rcpDirMin = 1.f / (std::min(std::abs(dirX), std::abs(dirY)) + dirReduce);
+
+        dirX = std::clamp(dirX * rcpDirMin, -s_FXAASpanMax, s_FXAASpanMax);
+        dirY = std::clamp(dirY * rcpDirMin, -s_FXAASpanMax, s_FXAASpanMax);
+
+        float centerX = (float)x;
+        float centerY = (float)y;
+
+        float a0[3], a1[3], b0[3], b1[3];
+        sample(centerX + dirX * (1.f / 3.f - 0.5f), centerY + dirY * (1.f / 3.f - 0.5f), a0);
+        sample(centerX + dirX * (2.f / 3.f - 0.5f), centerY + dirY * (2.f / 3.f - 0.5f), a1);
+        sample(centerX - dirX * 0.5f, centerY - dirY * 0.5f, b0);
+        sample(centerX + dirX * 0.5f, centerY + dirY * 0.5f, b1);
+
+        float rgbA[3], rgbB[3];
+        for (std::uint32_t c = 0; c < 3; c++) {
+            rgbA[c] = (a0[c] + a1[c]) * 0.5f;
+            rgbB[c] = rgbA[c] * 0.5f + (b0[c] + b1[c]) * 0.25f;
+        }
+
+        float lumaB = Luma(rgbB[0], rgbB[1], rgbB[2]);
+        const float* result = lumaB < lumaMin || lumaB > lumaMax ? rgbA : rgbB;
+
+        destination[x] = (PackChannel(result[0]) << 24) | (PackChannel(result[1]) << 16) |
+                         (PackChannel(result[2]) << 8) | 0xFF;
+    }
+}
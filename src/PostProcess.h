@@ -0,0 +1,119 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <cstdint>
+
+extern "C" {
+#include <graphics/image.h>
+}
+
+#include <glm/glm.hpp>
+
+#include "WorkerPool.h"
+#include "ColorFormat.h"
+
+struct PostProcessSettings {
+    bool Bloom = true;
+    float BloomThreshold = 0.7f;
+    float BloomIntensity = 0.35f;
+
+    // the bloom chain is hdr; the packed float formats keep it at 4 bytes per pixel
+    ColorFormat BloomFormat = ColorFormat::R11G11B10F;
+
+    // the first bloom level is this many times smaller than the target on each axis. a power of
+    // two; raising it is the cheapest way to shed post-processing memory
+    std::uint32_t BloomDownscale = 2;
+
+    bool Tonemap = true;
+    float Exposure = 1.2f;
+
+    bool ColorGrading = true;
+    float Saturation = 1.1f;
+    float Contrast = 1.05f;
+    glm::vec3 Gain = glm::vec3(1.f);
+
+    bool FXAA = true;
+};
+
+// full-screen passes run on a color attachment between the scene and the ui. per-pixel passes
+// (bloom composite, tonemap, grading) are fused into one kernel; only fxaa and the bloom chain,
+// which read neighbouring pixels, get passes of their own
+class PostProcessor {
+public:
+    PostProcessor(const std::shared_ptr<WorkerPool>& pool);
+    ~PostProcessor() = default;
+
+    PostProcessor(const PostProcessor&) = delete;
+    PostProcessor& operator=(const PostProcessor&) = delete;
+
+    void Process(image_t* target, const PostProcessSettings& settings);
+
+    // bytes held by the bloom chain and intermediate buffers, including every thread's scratch
+    std::size_t GetMemoryUsage() const;
+
+    struct BilinearTap {
+        std::uint32_t Index0, Index1;
+        float Weight;
+    };
+
+private:
+    // the bloom chain is released while bloom is off. any change frees every thread's scratch,
+    // so it shrinks to what the new settings need instead of staying at its largest
+    void Resize(std::uint32_t width, std::uint32_t height, const PostProcessSettings& settings);
+
+    // frees everything while no pass is enabled
+    void Release();
+
+    // horizontal filter taps are the same for every row of a pass
+    const BilinearTap* ComputeColumnTaps(std::uint32_t width, std::uint32_t sourceWidth,
+                                         float scale);
+
+    template <typename Func>
+    void ForEachRowBlock(std::uint32_t height, const Func& func);
+
+    void BrightPass(const image_t* source, float threshold);
+    void Downsample(const ColorImage& source, ColorImage& destination);
+    void UpsampleAdd(const ColorImage& source, ColorImage& destination);
+    // returns the bloom filter taps, or null when bloom is off
+    const BilinearTap* PrepareComposite(const PostProcessSettings& settings);
+
+    void Composite(image_t* target, const PostProcessSettings& settings);
+    void CompositeAndFXAA(image_t* target, const PostProcessSettings& settings);
+
+    // thread indexes m_Scratch, as handed out by ParallelForThreads
+    void CompositeRow(std::uint32_t thread, const std::uint32_t* source, std::uint32_t y,
+                      std::uint32_t* destination, bool lumaInAlpha,
+                      const PostProcessSettings& settings, const BilinearTap* columnTaps);
+
+    void FXAARow(const std::uint32_t* band, std::uint32_t top, std::uint32_t bottom,
+                 std::uint32_t row, std::uint32_t* destination);
+
+    std::shared_ptr<WorkerPool> m_Pool;
+    std::uint32_t m_Width, m_Height;
+
+    bool m_Bloom;
+    ColorFormat m_BloomFormat;
+    std::uint32_t m_BloomDownscale;
+    bool m_FXAA;
+    std::vector<ColorImage> m_BloomChain;
+    std::vector<BilinearTap> m_ColumnTaps;
+
+    // rows per band of the fused composite and fxaa, chosen for m_Width
+    std::uint32_t m_BandHeight;
+
+    // unprocessed rows on either side of every band boundary
+    LargeVector<std::uint32_t> m_BandEdges;
+
+    // scanline kernels convert packed pixels to planar floats first so their arithmetic compiles
+    // to straight vector loops; the fused composite and fxaa keep a band resident. one of each per
+    // pool thread, indexed like ParallelForThreads' thread index, so the render thread can free
+    // them between dispatches
+    struct alignas(64) ThreadScratch {
+        LargeVector<float> Row;
+        std::vector<std::uint32_t> Band;
+    };
+
+    std::vector<ThreadScratch> m_Scratch;
+};
@@ -0,0 +1,173 @@
+#include "Rasterizer.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+using FragmentStage = decltype(std::declval<pipeline>().shader.fragment_stage);
+
+// the query draw in flight. uniform_data is the only pointer rast hands the stages and it belongs
+// to the user's shaders, so the stand-in finds the query and the real stage here instead. held
+// for the whole draw; query draws from different threads take turns
+static std::mutex s_QueryMutex;
+static OcclusionQuery* s_QueryTarget = nullptr;
+static FragmentStage s_QueryFragment = nullptr;
+
+static std::atomic<std::uint32_t> s_NextCounterIndex = 0;
+
+void OcclusionQuery::Reset() {
+    for (auto& counter : m_Counters) {
+        counter.Value.store(0, std::memory_order_relaxed);
+    }
+
+    m_Samples = 0;
+}
+
+void OcclusionQuery::Count() {
+    static thread_local std::uint32_t counterIndex =
+        s_NextCounterIndex.fetch_add(1, std::memory_order_relaxed);
+
+    m_Counters[counterIndex % m_Counters.size()].Value.fetch_add(1, std::memory_order_relaxed);
+}
+
+void OcclusionQuery::Resolve() {
+    m_Samples = 0;
+    for (const auto& counter : m_Counters) {
+        m_Samples += counter.Value.load(std::memory_order_relaxed);
+    }
+}
+
+void Rasterizer::BeginQuery(OcclusionQuery& query) {
+    if (m_ActiveQuery != nullptr) {
+        throw std::runtime_error("A query is already active!");
+    }
+
+    query.Reset();
+    m_ActiveQuery = &query;
+}
+
+void Rasterizer::EndQuery() {
+    if (m_ActiveQuery == nullptr) {
+        throw std::runtime_error("No query is active!");
+    }
+
+    m_ActiveQuery->Resolve();
+    m_ActiveQuery = nullptr;
+}
+
+void Rasterizer::RenderBatch(WorkerPool& pool, const std::vector<BatchJob>& jobs) const {
+    const auto& rasterizers = GetBatchRasterizers(pool);
+
+    for (const auto& job : jobs) {
+        ValidateBatchJob(job);
+    }
+
+    pool.ParallelForThreads((std::uint32_t)jobs.size(), [&](std::uint32_t i, std::uint32_t thread) {
+        RunBatchJob(rasterizers[thread], jobs[i]);
+    });
+}
+
+const std::vector<rasterizer_t*>& Rasterizer::GetBatchRasterizers(const WorkerPool& pool) const {
+    if (m_BatchRasterizers.size() < pool.GetThreadCount()) {
+        throw std::runtime_error("Not enough batch rasterizers for the pool!");
+    }
+
+    return m_BatchRasterizers;
+}
+
+void Rasterizer::ValidateBatchJob(const BatchJob& job) {
+    bool clear = !job.ClearValues.empty();
+    if (clear && job.ClearValues.size() != job.Framebuffer->attachment_count) {
+        throw std::runtime_error("Attachment size mismatch!");
+    }
+}
+
+void Rasterizer::RunBatchJob(rasterizer_t* rast, const BatchJob& job) {
+    if (!job.ClearValues.empty()) {
+        framebuffer_clear(rast, job.Framebuffer, job.ClearValues.data());
+    }
+
+    for (indexed_render_call call : job.Calls) {
+        call.framebuffer = job.Framebuffer;
+        render_indexed(rast, &call);
+    }
+}
+
+void Rasterizer::ExecuteCommandLists(const std::vector<const CommandList*>& lists) {
+    m_MergedCommands.clear();
+
+    for (std::uint32_t i = 0; i < (std::uint32_t)lists.size(); i++) {
+        const auto& commands = lists[i]->m_Commands;
+
+        for (std::uint32_t j = 0; j < (std::uint32_t)commands.size(); j++) {
+            m_MergedCommands.push_back({ commands[j].SortKey, i, j });
+        }
+    }
+
+    // list and index break ties, so the order is total and the same on every run
+    std::sort(m_MergedCommands.begin(), m_MergedCommands.end(),
+              [](const CommandRef& lhs, const CommandRef& rhs) {
+                  if (lhs.SortKey != rhs.SortKey) {
+                      return lhs.SortKey < rhs.SortKey;
+                  }
+
+                  return lhs.List != rhs.List ? lhs.List < rhs.List : lhs.Index < rhs.Index;
+              });
+
+    alignas(16) std::uint8_t latched[UniformLatch::MaxSize];
+    if (m_Latch != nullptr) {
+        m_Latch->Read(latched);
+    }
+
+    for (const auto& ref : m_MergedCommands) {
+        indexed_render_call call = lists[ref.List]->m_Commands[ref.Index].Call;
+        if (m_Latch != nullptr) {
+            call.uniform_data = latched;
+        }
+
+        Draw(call);
+    }
+}
+
+void Rasterizer::Submit(indexed_render_call call) const {
+    // the copy lives on this frame's stack until render_indexed returns; draws complete
+    // synchronously, so every vertex of the draw sees the same block
+    alignas(16) std::uint8_t latched[UniformLatch::MaxSize];
+    if (m_Latch != nullptr) {
+        m_Latch->Read(latched);
+        call.uniform_data = latched;
+    }
+
+    Draw(call);
+}
+
+void Rasterizer::Draw(indexed_render_call call) const {
+    if (m_Condition != nullptr && !m_Condition->AnySamplesPassed()) {
+        return;
+    }
+
+    if (m_ActiveQuery == nullptr) {
+        render_indexed(m_Rasterizer, &call);
+        return;
+    }
+
+    // render_indexed hands the draw to rast's workers, which see these once they start on it
+    std::lock_guard lock(s_QueryMutex);
+    s_QueryTarget = m_ActiveQuery;
+    s_QueryFragment = call.pipeline->shader.fragment_stage;
+
+    struct pipeline queryPipeline = *call.pipeline;
+    queryPipeline.shader.fragment_stage = QueryFragmentStage;
+    call.pipeline = &queryPipeline;
+
+    render_indexed(m_Rasterizer, &call);
+}
+
+std::uint32_t Rasterizer::QueryFragmentStage(const shader_context* context) {
+    // one call is one passing sample only because rast depth-tests before it runs the fragment
+    // stage and skips the stage for samples that failed. a rast that shaded first, e.g. for
+    // shaders that write depth, would make this count every covered sample instead
+    s_QueryTarget->Count();
+
+    return s_QueryFragment(context);
+}
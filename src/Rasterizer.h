@@ -0,0 +1,220 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+
+#include <cstdint>
+
+extern "C" {
+#include <graphics/rasterizer.h>
+#include <graphics/image.h>
+}
+
+#include "LateLatch.h"
+#include "WorkerPool.h"
+
+#ifndef NDEBUG
+static constexpr bool s_IsDebug = true;
+#else
+static constexpr bool s_IsDebug = false;
+#endif
+
+// counts the samples that pass the depth test in the draws between Rasterizer::BeginQuery and
+// EndQuery. counting hooks the fragment stage, which the rasterizer only runs for samples that
+// passed the depth test (see Rasterizer::QueryFragmentStage)
+class OcclusionQuery {
+public:
+    OcclusionQuery() { m_Samples = 0; }
+
+    OcclusionQuery(const OcclusionQuery&) = delete;
+    OcclusionQuery& operator=(const OcclusionQuery&) = delete;
+
+    // valid once EndQuery returned; draws complete synchronously
+    std::uint64_t GetSampleCount() const { return m_Samples; }
+    bool AnySamplesPassed() const { return m_Samples > 0; }
+
+private:
+    friend class Rasterizer;
+
+    // fragment stages run on every rasterizer thread; counts are spread over cache lines by
+    // thread to keep them from contending
+    struct alignas(64) Counter {
+        std::atomic<std::uint64_t> Value;
+    };
+
+    void Reset();
+    void Count();
+    void Resolve();
+
+    std::array<Counter, 16> m_Counters;
+    std::uint64_t m_Samples;
+};
+
+// one independent view for Rasterizer::RenderBatch: an optional clear, then calls in order
+struct BatchJob {
+    framebuffer* Framebuffer;
+
+    // one value per attachment; empty skips the clear
+    std::vector<image_pixel> ClearValues;
+
+    // each call's framebuffer is replaced with Framebuffer
+    std::vector<indexed_render_call> Calls;
+};
+
+// draws recorded by one thread for Rasterizer::ExecuteCommandLists. several threads can fill
+// lists of their own for the same frame at once, e.g. one per scene region, without locking;
+// recording only copies the call
+class CommandList {
+public:
+    CommandList() = default;
+
+    CommandList(const CommandList&) = delete;
+    CommandList& operator=(const CommandList&) = delete;
+
+    // draws run in ascending key order across every executed list. the call's pipeline, vertex
+    // data and uniforms must stay alive until the list was executed
+    void Record(std::uint64_t sortKey, const indexed_render_call& call) {
+        m_Commands.push_back({ sortKey, call });
+    }
+
+    // keeps the storage for the next frame
+    void Reset() { m_Commands.clear(); }
+
+    std::size_t GetSize() const { return m_Commands.size(); }
+
+private:
+    friend class Rasterizer;
+
+    struct Command {
+        std::uint64_t SortKey;
+        indexed_render_call Call;
+    };
+
+    std::vector<Command> m_Commands;
+};
+
+class Rasterizer {
+public:
+    // batchThreads single-threaded rasterizers are created along with the shared one, for
+    // RenderBatch on a pool with up to that many threads. returns null if any of them failed
+    static std::shared_ptr<Rasterizer> Create(std::uint32_t batchThreads = 0) {
+        rasterizer_t* rast = rasterizer_create(!s_IsDebug);
+        if (rast == nullptr) {
+            return nullptr;
+        }
+
+        // owns rast from here on, and frees whatever was created if a batch rasterizer fails
+        std::shared_ptr<Rasterizer> rasterizer(new Rasterizer(rast));
+
+        for (std::uint32_t i = 0; i < batchThreads; i++) {
+            rasterizer_t* batchRast = rasterizer_create(false);
+            if (batchRast == nullptr) {
+                return nullptr;
+            }
+
+            rasterizer->m_BatchRasterizers.push_back(batchRast);
+        }
+
+        return rasterizer;
+    }
+
+    ~Rasterizer() {
+        for (rasterizer_t* rast : m_BatchRasterizers) {
+            rasterizer_destroy(rast);
+        }
+
+        rasterizer_destroy(m_Rasterizer);
+    }
+
+    Rasterizer(const Rasterizer&) = delete;
+    Rasterizer& operator=(const Rasterizer&) = delete;
+
+    rasterizer_t* Get() { return m_Rasterizer; }
+
+    void ClearFramebuffer(framebuffer* fb, const std::vector<image_pixel>& clearValues) const {
+        if (clearValues.size() != fb->attachment_count) {
+            throw std::runtime_error("Attachment size mismatch!");
+        }
+
+        framebuffer_clear(m_Rasterizer, fb, clearValues.data());
+    }
+
+    void RenderIndexed(indexed_render_call& call) const { Submit(call); }
+
+    // renders whole jobs on pool's threads, one job per thread at a time, each thread with a
+    // single-threaded rasterizer of its own. small framebuffers cannot keep the shared
+    // rasterizer's threads busy, but many of them side by side can. queries, conditional
+    // rendering and late latching do not apply to batched draws; blocks until every job is done
+    void RenderBatch(WorkerPool& pool, const std::vector<BatchJob>& jobs) const;
+
+    // one single-threaded rasterizer per thread of pool, indexed like ParallelForThreads' thread
+    // index. all of them were created with the rasterizer and never change, so any thread may
+    // call this; throws if pool has more threads than Create was given
+    const std::vector<rasterizer_t*>& GetBatchRasterizers(const WorkerPool& pool) const;
+
+    // throws if the job's clear values do not match its framebuffer
+    static void ValidateBatchJob(const BatchJob& job);
+
+    // clears and draws one job on rast, which only the calling thread may be using
+    static void RunBatchJob(rasterizer_t* rast, const BatchJob& job);
+
+    // merges lists by sort key and submits their draws on the calling thread. equal keys keep
+    // the order of lists, then the order of recording; when threads take draws as they come,
+    // unique keys keep the order from depending on which list a draw landed in. queries and
+    // conditional rendering apply as for RenderIndexed; a late latch is read once for all of the
+    // draws, so they see the same block. lists must not be recorded into meanwhile
+    void ExecuteCommandLists(const std::vector<const CommandList*>& lists);
+
+    // every draw until EndQuery adds its passing samples to query. queries do not nest
+    void BeginQuery(OcclusionQuery& query);
+    void EndQuery();
+
+    // draws until EndConditionalRender are skipped if query counted no samples. proxy geometry,
+    // e.g. a bounding box drawn without depth writes, decides whether the real mesh is drawn
+    void BeginConditionalRender(const OcclusionQuery& query) { m_Condition = &query; }
+    void EndConditionalRender() { m_Condition = nullptr; }
+
+    // draws until EndLateLatch replace their uniform_data with the latest block published to
+    // latch, read as the last step before each draw starts its vertex stage
+    void BeginLateLatch(const UniformLatch& latch) { m_Latch = &latch; }
+    void EndLateLatch() { m_Latch = nullptr; }
+
+private:
+    Rasterizer(rasterizer_t* rast) {
+        m_Rasterizer = rast;
+
+        m_ActiveQuery = nullptr;
+        m_Condition = nullptr;
+        m_Latch = nullptr;
+    }
+
+    // reads the late latch, if any, into call's uniforms, then draws it
+    void Submit(indexed_render_call call) const;
+
+    // draws call as it is, honoring the condition and the active query
+    void Draw(indexed_render_call call) const;
+
+    // installed while a query is active; counts, then runs the draw's own fragment stage with the
+    // context it was given
+    static std::uint32_t QueryFragmentStage(const shader_context* context);
+
+    rasterizer_t* m_Rasterizer;
+
+    // created in Create, indexed by pool thread
+    std::vector<rasterizer_t*> m_BatchRasterizers;
+
+    // merge order of the last ExecuteCommandLists, kept to reuse its storage
+    struct CommandRef {
+        std::uint64_t SortKey;
+        std::uint32_t List, Index;
+    };
+
+    std::vector<CommandRef> m_MergedCommands;
+
+    OcclusionQuery* m_ActiveQuery;
+    const OcclusionQuery* m_Condition;
+    const UniformLatch* m_Latch;
+};
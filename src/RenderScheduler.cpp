@@ -0,0 +1,190 @@
+#include "RenderScheduler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// how quickly cost estimates follow the latest jobs
+static constexpr double s_EstimateSmoothing = 0.25;
+
+RenderScheduler::RenderScheduler(const std::shared_ptr<Rasterizer>& rast,
+                                 const std::shared_ptr<WorkerPool>& pool) {
+    m_Rasterizer = rast;
+    m_Pool = pool;
+
+    m_AverageSeconds = 0.0;
+}
+
+void RenderScheduler::Execute(Clock::time_point deadline) {
+    const auto& rasterizers = m_Rasterizer->GetBatchRasterizers(*m_Pool);
+
+    // one drain per pool thread; each keeps taking jobs until the queues run dry
+    m_Pool->ParallelForThreads(m_Pool->GetThreadCount(), [&](std::uint32_t, std::uint32_t thread) {
+        Drain(rasterizers[thread], deadline);
+    });
+}
+
+void RenderScheduler::Attach(RenderContext* context) {
+    std::lock_guard lock(m_Mutex);
+
+    context->m_VirtualTime = GetVirtualTime();
+    m_Contexts.push_back(context);
+}
+
+void RenderScheduler::Detach(RenderContext* context) {
+    std::lock_guard lock(m_Mutex);
+    m_Contexts.erase(std::remove(m_Contexts.begin(), m_Contexts.end(), context), m_Contexts.end());
+}
+
+double RenderScheduler::GetVirtualTime() const {
+    double time = 0.0;
+    bool found = false;
+
+    for (const RenderContext* context : m_Contexts) {
+        if (!context->HasQueuedJobs() && context->m_Running == 0) {
+            continue;
+        }
+
+        time = found ? std::min(time, context->m_VirtualTime) : context->m_VirtualTime;
+        found = true;
+    }
+
+    return time;
+}
+
+RenderContext* RenderScheduler::PickContext() const {
+    RenderContext* picked = nullptr;
+
+    for (RenderContext* context : m_Contexts) {
+        if (!context->HasQueuedJobs() || (!context->m_HasEstimate && context->m_Running > 0)) {
+            continue;
+        }
+
+        if (picked == nullptr || context->m_VirtualTime < picked->m_VirtualTime) {
+            picked = context;
+        }
+    }
+
+    return picked;
+}
+
+void RenderScheduler::Drain(rasterizer_t* rast, Clock::time_point deadline) {
+    std::unique_lock lock(m_Mutex);
+
+    while (Clock::now() < deadline) {
+        RenderContext* context = PickContext();
+        if (context == nullptr) {
+            break;
+        }
+
+        const BatchJob& job = *context->m_Queue[context->m_QueueHead++];
+        if (!context->HasQueuedJobs()) {
+            context->m_Queue.clear();
+            context->m_QueueHead = 0;
+        }
+
+        context->m_Running++;
+
+        double estimate = context->m_HasEstimate ? context->m_Estimate : m_AverageSeconds;
+        context->m_VirtualTime += estimate / context->m_Weight;
+
+        lock.unlock();
+
+        auto t0 = Clock::now();
+        Rasterizer::RunBatchJob(rast, job);
+        double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        lock.lock();
+
+        context->m_VirtualTime += (seconds - estimate) / context->m_Weight;
+
+        if (context->m_HasEstimate) {
+            context->m_Estimate += (seconds - context->m_Estimate) * s_EstimateSmoothing;
+        } else {
+            context->m_Estimate = seconds;
+            context->m_HasEstimate = true;
+        }
+
+        m_AverageSeconds += (seconds - m_AverageSeconds) * s_EstimateSmoothing;
+
+        context->m_BusySeconds += seconds;
+        context->m_CompletedJobs++;
+
+        context->m_Running--;
+        if (context->m_Running == 0 && !context->HasQueuedJobs()) {
+            context->m_Idle.notify_all();
+        }
+    }
+}
+
+RenderContext::RenderContext(RenderScheduler& scheduler, std::uint32_t weight)
+    : m_Scheduler(scheduler) {
+    if (weight == 0) {
+        throw std::runtime_error("Context weight must be positive!");
+    }
+
+    m_QueueHead = 0;
+    m_Running = 0;
+    m_Weight = weight;
+
+    m_VirtualTime = 0.0;
+    m_Estimate = 0.0;
+    m_HasEstimate = false;
+
+    m_CompletedJobs = 0;
+    m_BusySeconds = 0.0;
+
+    m_Scheduler.Attach(this);
+}
+
+RenderContext::~RenderContext() {
+    {
+        std::unique_lock lock(m_Scheduler.m_Mutex);
+
+        m_Queue.clear();
+        m_QueueHead = 0;
+        m_Idle.wait(lock, [&]() { return m_Running == 0; });
+    }
+
+    m_Scheduler.Detach(this);
+}
+
+void RenderContext::Submit(const BatchJob& job) {
+    Rasterizer::ValidateBatchJob(job);
+
+    std::lock_guard lock(m_Scheduler.m_Mutex);
+
+    if (!HasQueuedJobs() && m_Running == 0) {
+        m_VirtualTime = std::max(m_VirtualTime, m_Scheduler.GetVirtualTime());
+    }
+
+    m_Queue.push_back(&job);
+}
+
+void RenderContext::Wait() {
+    std::unique_lock lock(m_Scheduler.m_Mutex);
+    m_Idle.wait(lock, [&]() { return !HasQueuedJobs() && m_Running == 0; });
+}
+
+void RenderContext::SetWeight(std::uint32_t weight) {
+    if (weight == 0) {
+        throw std::runtime_error("Context weight must be positive!");
+    }
+
+    std::lock_guard lock(m_Scheduler.m_Mutex);
+    m_Weight = weight;
+}
+
+std::uint32_t RenderContext::GetWeight() const {
+    std::lock_guard lock(m_Scheduler.m_Mutex);
+    return m_Weight;
+}
+
+std::uint64_t RenderContext::GetCompletedJobs() const {
+    std::lock_guard lock(m_Scheduler.m_Mutex);
+    return m_CompletedJobs;
+}
+
+double RenderContext::GetBusyMilliseconds() const {
+    std::lock_guard lock(m_Scheduler.m_Mutex);
+    return m_BusySeconds * 1000.0;
+}
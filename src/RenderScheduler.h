@@ -0,0 +1,127 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <cstdint>
+
+#include "Rasterizer.h"
+#include "WorkerPool.h"
+
+class RenderContext;
+
+// lets any number of contexts, e.g. one per session or viewport, share the process's WorkerPool
+// and the rasterizer's per-thread batch rasterizers, so serving more of them never adds threads.
+// contexts queue whole jobs; Execute drains the queues on the pool's threads, and which context
+// the next job comes from is decided by weighted fair share over the time each context's jobs
+// took
+class RenderScheduler {
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    RenderScheduler(const std::shared_ptr<Rasterizer>& rast,
+                    const std::shared_ptr<WorkerPool>& pool);
+    ~RenderScheduler() = default;
+
+    RenderScheduler(const RenderScheduler&) = delete;
+    RenderScheduler& operator=(const RenderScheduler&) = delete;
+
+    // runs queued jobs on every pool thread until none are left or deadline passed; jobs not
+    // started by then stay queued for the next Execute. with more work queued than fits before
+    // the deadline, the weights decide how the time is split. jobs submitted meanwhile may run now
+    // or in the next Execute. a dispatch like any other on the pool, so it takes turns with the
+    // pool's other dispatches
+    void Execute(Clock::time_point deadline = Clock::time_point::max());
+
+private:
+    friend class RenderContext;
+
+    void Attach(RenderContext* context);
+    void Detach(RenderContext* context);
+
+    // the lowest virtual time among contexts with work, so a context that was idle starts level
+    // with them instead of catching up on the share it did not use
+    double GetVirtualTime() const;
+
+    // the context with queued jobs that is furthest behind its share, or null
+    RenderContext* PickContext() const;
+
+    // takes jobs until PickContext finds none or deadline passed
+    void Drain(rasterizer_t* rast, Clock::time_point deadline);
+
+    std::shared_ptr<Rasterizer> m_Rasterizer;
+    std::shared_ptr<WorkerPool> m_Pool;
+
+    // guards the contexts' queues and accounting as well
+    std::mutex m_Mutex;
+    std::vector<RenderContext*> m_Contexts;
+
+    // average job cost over every context, what a context is charged before its own first job
+    // finished
+    double m_AverageSeconds;
+};
+
+// a session's or viewport's handle on a RenderScheduler. jobs are taken in submission order but
+// may run concurrently on different threads, so draws that depend on each other belong in one
+// job. the scheduler must outlive its contexts
+class RenderContext {
+public:
+    // a context with twice the weight of another gets twice its share of render time while both
+    // have work. a large weight works as priority
+    RenderContext(RenderScheduler& scheduler, std::uint32_t weight = 1);
+
+    // drops jobs that have not started and waits for the running ones
+    ~RenderContext();
+
+    RenderContext(const RenderContext&) = delete;
+    RenderContext& operator=(const RenderContext&) = delete;
+
+    // queues job by reference, so submitting never copies its vectors. the job itself, its
+    // framebuffer, vertex data and uniforms must stay alive and unchanged until it ran
+    void Submit(const BatchJob& job);
+
+    // blocks until every submitted job finished. jobs only run inside Execute, so another thread
+    // must be executing or about to
+    void Wait();
+
+    void SetWeight(std::uint32_t weight);
+    std::uint32_t GetWeight() const;
+
+    std::uint64_t GetCompletedJobs() const;
+
+    // render time the context's jobs took on the pool's threads
+    double GetBusyMilliseconds() const;
+
+private:
+    friend class RenderScheduler;
+
+    RenderScheduler& m_Scheduler;
+
+    bool HasQueuedJobs() const { return m_QueueHead < m_Queue.size(); }
+
+    // everything below is guarded by the scheduler's mutex
+
+    // jobs from m_QueueHead on are waiting. cleared once drained, so the storage is reused
+    // rather than reallocated
+    std::vector<const BatchJob*> m_Queue;
+    std::size_t m_QueueHead;
+
+    std::uint32_t m_Running;
+    std::condition_variable m_Idle;
+
+    std::uint32_t m_Weight;
+
+    // weighted render time: advances by seconds / weight, ahead of time by the estimate when a
+    // job is taken and corrected once it finished, so threads taking jobs at once see the cost.
+    // until its first job was measured a context has no estimate of its own and runs one job at
+    // a time, so a new context cannot take every thread before it was charged anything
+    double m_VirtualTime;
+    double m_Estimate;
+    bool m_HasEstimate;
+
+    std::uint64_t m_CompletedJobs;
+    double m_BusySeconds;
+};
@@ -0,0 +1,328 @@
+#include "SamplingProfiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <new>
+#include <unordered_map>
+
+#include <cstdlib>
+
+#ifdef __linux__
+#include <cxxabi.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+static constexpr std::uint32_t s_MaxDepth = 48;
+
+struct StackSample {
+    std::atomic<bool> Ready;
+
+    int ThreadID;
+    std::uint32_t Depth;
+    void* Frames[s_MaxDepth];
+};
+
+// the signal handler can only reach globals
+static StackSample* s_Samples = nullptr;
+static std::uint32_t s_Capacity = 0;
+static std::atomic<std::uint32_t> s_SampleCount = 0;
+static std::atomic<bool> s_Active = false;
+
+SamplingProfiler::SamplingProfiler(std::uint32_t maxSamples) {
+    m_MaxSamples = maxSamples;
+    m_Running = false;
+}
+
+SamplingProfiler::~SamplingProfiler() {
+    if (m_Running) {
+        Stop("");
+    }
+}
+
+std::uint32_t SamplingProfiler::GetSampleCount() const {
+    if (!m_Running) {
+        return 0;
+    }
+
+    return std::min(s_SampleCount.load(std::memory_order_relaxed), s_Capacity);
+}
+
+#ifdef __linux__
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+// the cpu-time clock of another thread in this process; MAKE_THREAD_CPUCLOCK(tid, CPUCLOCK_SCHED)
+// from the kernel's posix-timers.h
+static clockid_t GetThreadClock(int threadID) { return ((~(clockid_t)threadID) << 3) | 6; }
+
+// where the signal landed and the frame pointer at that moment
+static bool GetFrameRegisters(const ucontext_t* context, std::uintptr_t& pc, std::uintptr_t& fp) {
+#if defined(__x86_64__)
+    pc = (std::uintptr_t)context->uc_mcontext.gregs[REG_RIP];
+    fp = (std::uintptr_t)context->uc_mcontext.gregs[REG_RBP];
+    return true;
+#elif defined(__aarch64__)
+    pc = (std::uintptr_t)context->uc_mcontext.pc;
+    fp = (std::uintptr_t)context->uc_mcontext.regs[29];
+    return true;
+#else
+    return false;
+#endif
+}
+
+// copies size bytes from address in this process. a frame pointer that does not point at a frame
+// makes the syscall fail with EFAULT instead of faulting inside the handler
+static bool ReadMemory(std::uintptr_t address, void* destination, std::size_t size) {
+    iovec local{ destination, size };
+    iovec remote{ (void*)address, size };
+
+    return process_vm_readv(getpid(), &local, 1, &remote, 1, 0) == (ssize_t)size;
+}
+
+// follows the chain of frame records, each the caller's frame pointer followed by the return
+// address, starting at the interrupted frame. code built without frame pointers, like most system
+// libraries, breaks the chain: the walk stops at the first record that cannot be one, and a leaf
+// interrupted before its prologue ran loses its caller
+static std::uint32_t WalkFramePointers(const ucontext_t* context, void** frames) {
+    std::uintptr_t pc, fp;
+    if (!GetFrameRegisters(context, pc, fp)) {
+        return 0;
+    }
+
+    std::uint32_t depth = 0;
+    frames[depth++] = (void*)pc;
+
+    while (depth < s_MaxDepth && fp != 0 && fp % sizeof(std::uintptr_t) == 0) {
+        std::uintptr_t record[2];
+        if (!ReadMemory(fp, record, sizeof(record)) || record[1] == 0) {
+            break;
+        }
+
+        frames[depth++] = (void*)record[1];
+
+        // the stack grows down, so every caller's frame lies above its callee's
+        if (record[0] <= fp) {
+            break;
+        }
+
+        fp = record[0];
+    }
+
+    return depth;
+}
+
+// only async-signal-safe calls in here. unwinders like backtrace may take locks or allocate while
+// loading unwind tables, so the stack is walked by hand into the preallocated sample
+static void OnSample(int signal, siginfo_t* info, void* context) {
+    if (!s_Active.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    int savedErrno = errno;
+
+    std::uint32_t index = s_SampleCount.fetch_add(1, std::memory_order_relaxed);
+    if (index < s_Capacity) {
+        auto& sample = s_Samples[index];
+
+        sample.ThreadID = (int)syscall(SYS_gettid);
+        sample.Depth = WalkFramePointers((const ucontext_t*)context, sample.Frames);
+        sample.Ready.store(true, std::memory_order_release);
+    }
+
+    errno = savedErrno;
+}
+
+static std::string GetFrameName(void* address, bool returnAddress) {
+    // return addresses point past the call; step back into it so the lookup lands in the caller
+    auto lookup = (void*)((std::uintptr_t)address - (returnAddress ? 1 : 0));
+
+    Dl_info info;
+    if (dladdr(lookup, &info) == 0) {
+        return "[unknown]";
+    }
+
+    if (info.dli_sname != nullptr) {
+        int status;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+
+        std::string name = status == 0 ? demangled : info.dli_sname;
+        std::free(demangled);
+
+        return name;
+    }
+
+    std::string module = info.dli_fname != nullptr ? info.dli_fname : "[unknown]";
+    module = module.substr(module.find_last_of('/') + 1);
+
+    // unnamed code in shared libraries is lumped together per library. inside the executable
+    // the offset is kept, so static functions can still be looked up with addr2line
+    Dl_info self;
+    if (dladdr((void*)&GetFrameName, &self) == 0 || info.dli_fbase != self.dli_fbase) {
+        return "[" + module + "]";
+    }
+
+    char offset[32];
+    snprintf(offset, sizeof(offset), "+0x%zx",
+             (std::size_t)((std::uintptr_t)lookup - (std::uintptr_t)info.dli_fbase));
+
+    return module + offset;
+}
+
+bool SamplingProfiler::Start(std::uint32_t frequency) {
+    if (m_Running || s_Active.load(std::memory_order_relaxed) || frequency == 0) {
+        return false;
+    }
+
+    m_Buffer.resize(sizeof(StackSample) * m_MaxSamples);
+    s_Samples = (StackSample*)m_Buffer.data();
+    s_Capacity = m_MaxSamples;
+
+    for (std::uint32_t i = 0; i < m_MaxSamples; i++) {
+        new (&s_Samples[i]) StackSample;
+        s_Samples[i].Ready.store(false, std::memory_order_relaxed);
+    }
+
+    s_SampleCount.store(0, std::memory_order_relaxed);
+
+    struct sigaction action{};
+    action.sa_sigaction = OnSample;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    DIR* directory = opendir("/proc/self/task");
+    if (directory == nullptr) {
+        return false;
+    }
+
+    sigaction(SIGPROF, &action, nullptr);
+    s_Active.store(true, std::memory_order_relaxed);
+
+    // tv_nsec must stay below a second; 1 Hz is a whole second
+    std::uint64_t period = 1000000000ull / std::min(frequency, 1000000000u);
+
+    itimerspec interval{};
+    interval.it_interval.tv_sec = (time_t)(period / 1000000000ull);
+    interval.it_interval.tv_nsec = (long)(period % 1000000000ull);
+    interval.it_value = interval.it_interval;
+
+    while (dirent* entry = readdir(directory)) {
+        int threadID = atoi(entry->d_name);
+        if (threadID <= 0) {
+            continue;
+        }
+
+        sigevent event{};
+        event.sigev_notify = SIGEV_THREAD_ID;
+        event.sigev_signo = SIGPROF;
+        event.sigev_notify_thread_id = threadID;
+
+        timer_t timer;
+        if (timer_create(GetThreadClock(threadID), &event, &timer) != 0) {
+            continue;
+        }
+
+        if (timer_settime(timer, 0, &interval, nullptr) != 0) {
+            timer_delete(timer);
+            continue;
+        }
+
+        m_Timers.push_back(timer);
+
+        std::ifstream comm("/proc/self/task/" + std::string(entry->d_name) + "/comm");
+        std::string name;
+        std::getline(comm, name);
+
+        // one root per thread, so workers with the same name stay apart in the graph
+        m_ThreadNames.emplace_back(threadID, name + " (" + entry->d_name + ")");
+    }
+
+    closedir(directory);
+
+    m_Running = !m_Timers.empty();
+    if (!m_Running) {
+        s_Active.store(false, std::memory_order_relaxed);
+    }
+
+    return m_Running;
+}
+
+bool SamplingProfiler::Stop(const std::string& path) {
+    if (!m_Running) {
+        return false;
+    }
+
+    for (void* timer : m_Timers) {
+        timer_delete((timer_t)timer);
+    }
+
+    // a signal already in flight sees this and returns. one that got past the check finishes
+    // into the buffer, which stays allocated until the next Start, and is skipped below
+    s_Active.store(false, std::memory_order_relaxed);
+    signal(SIGPROF, SIG_IGN);
+
+    std::unordered_map<int, std::string> threadNames;
+    for (const auto& [threadID, name] : m_ThreadNames) {
+        threadNames[threadID] = name;
+    }
+
+    std::unordered_map<void*, std::string> frameNames;
+    std::map<std::string, std::uint32_t> stacks;
+
+    std::uint32_t count = std::min(s_SampleCount.load(std::memory_order_relaxed), s_Capacity);
+    for (std::uint32_t i = 0; i < count; i++) {
+        const auto& sample = s_Samples[i];
+        if (!sample.Ready.load(std::memory_order_acquire) || sample.Depth == 0) {
+            continue;
+        }
+
+        std::string stack = threadNames[sample.ThreadID];
+
+        // outermost frame first. the innermost is where the signal landed, not a return address
+        for (std::uint32_t j = sample.Depth; j-- > 0;) {
+            void* address = sample.Frames[j];
+
+            auto it = frameNames.find(address);
+            if (it == frameNames.end()) {
+                it = frameNames.emplace(address, GetFrameName(address, j > 0)).first;
+            }
+
+            stack += ";" + it->second;
+        }
+
+        stacks[stack]++;
+    }
+
+    m_Timers.clear();
+    m_ThreadNames.clear();
+    m_Running = false;
+
+    std::ofstream stream(path);
+    if (!stream.is_open()) {
+        return false;
+    }
+
+    for (const auto& [stack, samples] : stacks) {
+        stream << stack << " " << samples << "\n";
+    }
+
+    return true;
+}
+
+#else
+
+bool SamplingProfiler::Start(std::uint32_t frequency) { return false; }
+bool SamplingProfiler::Stop(const std::string& path) { return false; }
+
+#endif
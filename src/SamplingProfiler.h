@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+// in-process sampling profiler for machines where perf is not available. every thread running
+// at Start, including the rasterizer's workers, gets a timer on its own cpu clock that raises
+// SIGPROF, and the handler records the thread's call stack. Stop writes collapsed stacks
+// ("thread;outer;inner count" per line) for flamegraph.pl, speedscope or inferno.
+//
+// frames are named through dladdr, which only sees exported symbols; link with -rdynamic to
+// resolve the executable's own functions. static functions (e.g. the shaders) are written as
+// module+offset, for addr2line. linux only; elsewhere Start returns false
+class SamplingProfiler {
+public:
+    SamplingProfiler(std::uint32_t maxSamples = 16384);
+    ~SamplingProfiler();
+
+    SamplingProfiler(const SamplingProfiler&) = delete;
+    SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+
+    // only one profiler can run at a time, since the signal handler is process-wide. returns
+    // false if no thread's timer could be armed
+    bool Start(std::uint32_t frequency = 1000);
+
+    // returns whether the file was written
+    bool Stop(const std::string& path);
+
+    bool IsRunning() const { return m_Running; }
+
+    // samples taken so far; sampling stops silently once the buffer is full
+    std::uint32_t GetSampleCount() const;
+
+private:
+    std::vector<std::uint8_t> m_Buffer;
+    std::uint32_t m_MaxSamples;
+    bool m_Running;
+
+    std::vector<void*> m_Timers;
+    std::vector<std::pair<int, std::string>> m_ThreadNames;
+};
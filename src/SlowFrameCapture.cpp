@@ -0,0 +1,199 @@
+#include "SlowFrameCapture.h"
+
+#include <algorithm>
+#include <fstream>
+
+SlowFrameCapture::SlowFrameCapture(std::uint32_t historyFrames, std::uint32_t maxCaptures) {
+    m_Frames.resize(historyFrames);
+    for (auto& frame : m_Frames) {
+        frame.Index = 0;
+    }
+
+    m_Budget = 0.0;
+    m_OutputDirectory = ".";
+
+    m_PendingFrame = 0;
+    m_NextCaptureFrame = 0;
+
+    m_CaptureCount = 0;
+    m_MaxCaptures = maxCaptures;
+}
+
+SlowFrameCapture::Frame& SlowFrameCapture::GetFrame(std::uint64_t frame) {
+    auto& slot = m_Frames[frame % m_Frames.size()];
+
+    // a slot is reused from the oldest frame in the history
+    if (slot.Index != frame) {
+        slot.Index = frame;
+        slot.Milliseconds = 0.0;
+        slot.HasZones = false;
+
+        slot.ZoneCount = slot.DrawCount = slot.CounterCount = 0;
+    }
+
+    return slot;
+}
+
+void SlowFrameCapture::RecordDraw(std::uint64_t frame, const char* name,
+                                  const indexed_render_call& call) {
+    auto& slot = GetFrame(frame);
+    if (slot.DrawCount == MaxDraws) {
+        return;
+    }
+
+    auto& draw = slot.Draws[slot.DrawCount++];
+    draw.Name = name;
+    draw.IndexCount = call.index_count;
+    draw.InstanceCount = call.instance_count;
+    draw.Width = call.framebuffer->width;
+    draw.Height = call.framebuffer->height;
+    draw.DepthTest = call.pipeline->depth.test;
+    draw.DepthWrite = call.pipeline->depth.write;
+    draw.CullBack = call.pipeline->cull_back;
+}
+
+void SlowFrameCapture::RecordCounter(std::uint64_t frame, const char* name, double value) {
+    auto& slot = GetFrame(frame);
+    if (slot.CounterCount < MaxCounters) {
+        slot.Counters[slot.CounterCount++] = { name, value };
+    }
+}
+
+void SlowFrameCapture::RecordZones(const TimestampQueryPool& timestamps) {
+    std::uint64_t frame = timestamps.GetResultFrame();
+
+    // zones of frames that already left the history are of no use
+    auto& slot = m_Frames[frame % m_Frames.size()];
+    if (frame == 0 || slot.Index != frame) {
+        return;
+    }
+
+    const auto& results = timestamps.GetResults();
+    slot.ZoneCount = std::min((std::uint32_t)results.size(), MaxZones);
+    slot.HasZones = true;
+
+    for (std::uint32_t i = 0; i < slot.ZoneCount; i++) {
+        const auto& result = results[i];
+        slot.Zones[i] = { result.Name, result.Begin, result.Milliseconds, result.Counters };
+    }
+
+    if (m_PendingFrame != 0 && frame >= m_PendingFrame) {
+        WriteCapture(m_PendingFrame);
+        m_PendingFrame = 0;
+    }
+}
+
+bool SlowFrameCapture::EndFrame(std::uint64_t frame, double milliseconds) {
+    GetFrame(frame).Milliseconds = milliseconds;
+
+    bool slow = m_Budget > 0.0 && milliseconds > m_Budget;
+    if (!slow || m_PendingFrame != 0 || frame < m_NextCaptureFrame ||
+        m_CaptureCount == m_MaxCaptures) {
+        return false;
+    }
+
+    m_PendingFrame = frame;
+    m_NextCaptureFrame = frame + m_Frames.size();
+
+    return true;
+}
+
+// chrome's trace event format: complete ("X") events for zones, counter ("C") events for the
+// recorded values. everything that has no timeline goes into metadata
+void SlowFrameCapture::WriteCapture(std::uint64_t slowFrame) {
+    std::vector<const Frame*> frames;
+    for (const auto& frame : m_Frames) {
+        if (frame.Index != 0 && frame.Index <= slowFrame + 1) {
+            frames.push_back(&frame);
+        }
+    }
+
+    std::sort(frames.begin(), frames.end(),
+              [](const Frame* lhs, const Frame* rhs) { return lhs->Index < rhs->Index; });
+
+    // timestamps are relative to the first zone in the history
+    TimestampQueryPool::Clock::time_point origin{};
+    for (const Frame* frame : frames) {
+        if (frame->ZoneCount > 0) {
+            origin = frame->Zones[0].Begin;
+            break;
+        }
+    }
+
+    auto microseconds = [&](TimestampQueryPool::Clock::time_point time) {
+        return std::chrono::duration<double, std::micro>(time - origin).count();
+    };
+
+    std::string path =
+        m_OutputDirectory + "/slow-frame-" + std::to_string(slowFrame) + ".json";
+
+    std::ofstream stream(path);
+    if (!stream.is_open()) {
+        return;
+    }
+
+    stream << "{\n\"traceEvents\": [";
+
+    bool first = true;
+    for (const Frame* frame : frames) {
+        for (std::uint32_t i = 0; i < frame->ZoneCount; i++) {
+            const auto& zone = frame->Zones[i];
+
+            stream << (first ? "" : ",") << "\n  { \"name\": \"" << zone.Name
+                   << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0, \"ts\": "
+                   << microseconds(zone.Begin) << ", \"dur\": " << zone.Milliseconds * 1000.0
+                   << ", \"args\": { \"frame\": " << frame->Index;
+
+            for (std::uint32_t j = 0; j < s_HardwareCounterCount; j++) {
+                stream << ", \"" << GetHardwareCounterName((HardwareCounter)j)
+                       << "\": " << zone.Counters.Values[j];
+            }
+
+            stream << " } }";
+            first = false;
+        }
+
+        // counters are sampled once per frame; pin them to the frame's first zone
+        double time = frame->ZoneCount > 0 ? microseconds(frame->Zones[0].Begin) : 0.0;
+        for (std::uint32_t i = 0; i < frame->CounterCount; i++) {
+            const auto& counter = frame->Counters[i];
+
+            stream << (first ? "" : ",") << "\n  { \"name\": \"" << counter.Name
+                   << "\", \"ph\": \"C\", \"pid\": 0, \"ts\": " << time
+                   << ", \"args\": { \"value\": " << counter.Value << " } }";
+
+            first = false;
+        }
+    }
+
+    stream << "\n],\n\"metadata\": {\n  \"slow_frame\": " << slowFrame
+           << ",\n  \"budget_ms\": " << m_Budget << ",\n  \"frames\": [";
+
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        const Frame* frame = frames[i];
+
+        stream << (i > 0 ? "," : "") << "\n    { \"frame\": " << frame->Index
+               << ", \"milliseconds\": " << frame->Milliseconds
+               << ", \"zones_resolved\": " << (frame->HasZones ? "true" : "false")
+               << ", \"draws\": [";
+
+        for (std::uint32_t j = 0; j < frame->DrawCount; j++) {
+            const auto& draw = frame->Draws[j];
+
+            stream << (j > 0 ? ", " : "") << "{ \"name\": \"" << draw.Name
+                   << "\", \"indices\": " << draw.IndexCount
+                   << ", \"instances\": " << draw.InstanceCount << ", \"width\": " << draw.Width
+                   << ", \"height\": " << draw.Height
+                   << ", \"depth_test\": " << (draw.DepthTest ? "true" : "false")
+                   << ", \"depth_write\": " << (draw.DepthWrite ? "true" : "false")
+                   << ", \"cull_back\": " << (draw.CullBack ? "true" : "false") << " }";
+        }
+
+        stream << "] }";
+    }
+
+    stream << "\n  ]\n}\n}\n";
+
+    m_CaptureCount++;
+    m_LastCapturePath = path;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+extern "C" {
+#include <graphics/rasterizer.h>
+}
+
+#include "TimestampQuery.h"
+
+// watchdog for hitches. keeps the trace zones, counters and draw calls of the last few frames in
+// a ring buffer, and when a frame goes over budget, writes that history to disk as a chrome trace
+// (chrome://tracing, perfetto) with the stats alongside. zones resolve a few frames late, so a
+// capture is written once the slow frame's zones are in
+class SlowFrameCapture {
+public:
+    static constexpr std::uint32_t MaxZones = 16;
+    static constexpr std::uint32_t MaxDraws = 16;
+    static constexpr std::uint32_t MaxCounters = 16;
+
+    SlowFrameCapture(std::uint32_t historyFrames = 8, std::uint32_t maxCaptures = 16);
+    ~SlowFrameCapture() = default;
+
+    SlowFrameCapture(const SlowFrameCapture&) = delete;
+    SlowFrameCapture& operator=(const SlowFrameCapture&) = delete;
+
+    // frames slower than this are captured; 0 disables the watchdog
+    void SetBudget(double milliseconds) { m_Budget = milliseconds; }
+    double GetBudget() const { return m_Budget; }
+
+    void SetOutputDirectory(const std::string& directory) { m_OutputDirectory = directory; }
+
+    // name must outlive the capture, e.g. a string literal
+    void RecordDraw(std::uint64_t frame, const char* name, const indexed_render_call& call);
+    void RecordCounter(std::uint64_t frame, const char* name, double value);
+
+    // takes the pool's latest resolved frame, and writes any capture that was waiting on it
+    void RecordZones(const TimestampQueryPool& timestamps);
+
+    // the frame's total time. returns whether it was over budget and a capture is pending
+    bool EndFrame(std::uint64_t frame, double milliseconds);
+
+    std::uint32_t GetCaptureCount() const { return m_CaptureCount; }
+    const std::string& GetLastCapturePath() const { return m_LastCapturePath; }
+
+private:
+    struct Zone {
+        const char* Name;
+        TimestampQueryPool::Clock::time_point Begin;
+        double Milliseconds;
+        CounterValues Counters;
+    };
+
+    struct Draw {
+        const char* Name;
+        std::uint32_t IndexCount, InstanceCount;
+        std::uint32_t Width, Height;
+        bool DepthTest, DepthWrite, CullBack;
+    };
+
+    struct Counter {
+        const char* Name;
+        double Value;
+    };
+
+    struct Frame {
+        std::uint64_t Index;
+        double Milliseconds;
+        bool HasZones;
+
+        std::uint32_t ZoneCount, DrawCount, CounterCount;
+        Zone Zones[MaxZones];
+        Draw Draws[MaxDraws];
+        Counter Counters[MaxCounters];
+    };
+
+    Frame& GetFrame(std::uint64_t frame);
+    void WriteCapture(std::uint64_t slowFrame);
+
+    std::vector<Frame> m_Frames;
+    double m_Budget;
+    std::string m_OutputDirectory;
+
+    // the slow frame whose capture waits for its zones; 0 when none
+    std::uint64_t m_PendingFrame;
+
+    // frames before this are not captured again, so one hitch spanning several frames is one file
+    std::uint64_t m_NextCaptureFrame;
+
+    std::uint32_t m_CaptureCount, m_MaxCaptures;
+    std::string m_LastCapturePath;
+};
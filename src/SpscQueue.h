@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <type_traits>
+
+#include <cstddef>
+
+// fixed-capacity ring between exactly one producer thread and one consumer thread. neither side
+// locks or allocates; a full queue refuses the push instead of waiting
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+public:
+    static_assert(std::is_trivially_copyable_v<T> && (Capacity & (Capacity - 1)) == 0);
+
+    SpscQueue() {
+        m_Head.Value.store(0, std::memory_order_relaxed);
+        m_Tail.Value.store(0, std::memory_order_relaxed);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // producer only
+    bool Push(const T& item) {
+        std::size_t tail = m_Tail.Value.load(std::memory_order_relaxed);
+        if (tail - m_Head.Value.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+
+        m_Items[tail % Capacity] = item;
+        m_Tail.Value.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // consumer only
+    bool Pop(T* item) {
+        std::size_t head = m_Head.Value.load(std::memory_order_relaxed);
+        if (head == m_Tail.Value.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        *item = m_Items[head % Capacity];
+        m_Head.Value.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+private:
+    // each side writes only its own index; keeping them on separate cache lines stops every push
+    // from invalidating the consumer's line and the other way around
+    struct alignas(64) Index {
+        std::atomic<std::size_t> Value;
+    };
+
+    Index m_Head, m_Tail;
+    std::array<T, Capacity> m_Items;
+};
@@ -0,0 +1,105 @@
+#include "TimestampQuery.h"
+
+TimestampQueryPool::TimestampQueryPool(std::uint32_t queriesPerFrame,
+                                       std::uint32_t framesInFlight) {
+    m_QueriesPerFrame = queriesPerFrame;
+    m_FrameIndex = 0;
+    m_ResultFrame = 0;
+
+    m_Counters = nullptr;
+    m_ResultThreadCount = 0;
+
+    // the frame being recorded plus the ones whose results are not read back yet
+    m_Frames.resize(framesInFlight + 1);
+    for (auto& frame : m_Frames) {
+        frame.Index = 0;
+        frame.Count = 0;
+        frame.Queries.resize(queriesPerFrame);
+        frame.Counters = nullptr;
+        frame.ThreadCount = 0;
+    }
+
+    m_Results.reserve(queriesPerFrame);
+}
+
+void TimestampQueryPool::BeginFrame() {
+    m_FrameIndex++;
+
+    // the slot about to be reused holds the oldest frame in flight
+    auto& frame = m_Frames[m_FrameIndex % m_Frames.size()];
+    if (frame.Index != 0) {
+        ResolveFrame(frame);
+    }
+
+    frame.Index = m_FrameIndex;
+    frame.Count = 0;
+
+    // only reallocates when threads were added to the counters
+    frame.Counters = m_Counters;
+    frame.ThreadCount = m_Counters != nullptr ? m_Counters->GetThreadCount() : 0;
+    frame.Samples.resize((std::size_t)m_QueriesPerFrame * 2 * frame.ThreadCount);
+}
+
+void TimestampQueryPool::ResolveFrame(Frame& frame) {
+    m_Results.clear();
+
+    m_ResultThreadCount = frame.ThreadCount;
+    m_ThreadResults.resize((std::size_t)frame.Count * frame.ThreadCount);
+
+    for (std::uint32_t i = 0; i < frame.Count; i++) {
+        const auto& query = frame.Queries[i];
+        auto duration = std::chrono::duration<double, std::milli>(query.End - query.Begin);
+
+        Result result = { query.Name, duration.count(), query.Begin, {} };
+
+        const CounterValues* begin = GetSample(frame, i, false);
+        const CounterValues* end = GetSample(frame, i, true);
+
+        for (std::uint32_t j = 0; j < frame.ThreadCount; j++) {
+            auto& delta = m_ThreadResults[(std::size_t)i * frame.ThreadCount + j];
+            for (std::uint32_t k = 0; k < s_HardwareCounterCount; k++) {
+                delta.Values[k] = end[j].Values[k] - begin[j].Values[k];
+            }
+
+            result.Counters += delta;
+        }
+
+        m_Results.push_back(result);
+    }
+
+    m_ResultFrame = frame.Index;
+}
+
+std::uint32_t TimestampQueryPool::Begin(const char* name) {
+    auto& frame = m_Frames[m_FrameIndex % m_Frames.size()];
+    if (frame.Count == m_QueriesPerFrame) {
+        return InvalidQuery;
+    }
+
+    std::uint32_t index = frame.Count++;
+    auto& query = frame.Queries[index];
+
+    query.Name = name;
+    if (frame.ThreadCount > 0) {
+        frame.Counters->Sample(GetSample(frame, index, false), frame.ThreadCount);
+    }
+
+    // read the clock last so the counter reads are not part of the range
+    query.Begin = query.End = Clock::now();
+
+    return index;
+}
+
+void TimestampQueryPool::End(std::uint32_t query) {
+    if (query == InvalidQuery) {
+        return;
+    }
+
+    // rasterizer calls return once all of their workers are done, so this is completion time
+    auto& frame = m_Frames[m_FrameIndex % m_Frames.size()];
+    frame.Queries[query].End = Clock::now();
+
+    if (frame.ThreadCount > 0) {
+        frame.Counters->Sample(GetSample(frame, query, true), frame.ThreadCount);
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include <cstdint>
+
+#include "HardwareCounters.h"
+
+// wall-clock timing of rasterizer work (draws, clears, ui rendering). each range covers the
+// work from submission until every worker finished it. results are read back framesInFlight
+// frames later, so reading them never waits on work that is still in flight. with hardware
+// counters attached, each range also records what every thread in the process counted during it
+class TimestampQueryPool {
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    static constexpr std::uint32_t InvalidQuery = ~(std::uint32_t)0;
+
+    struct Result {
+        const char* Name;
+        double Milliseconds;
+        Clock::time_point Begin;
+
+        // summed over all threads; zero without hardware counters
+        CounterValues Counters;
+    };
+
+    TimestampQueryPool(std::uint32_t queriesPerFrame, std::uint32_t framesInFlight = 2);
+    ~TimestampQueryPool() = default;
+
+    TimestampQueryPool(const TimestampQueryPool&) = delete;
+    TimestampQueryPool& operator=(const TimestampQueryPool&) = delete;
+
+    // starts recording a new frame and resolves the oldest frame in flight into GetResults
+    void BeginFrame();
+
+    // name must outlive the pool, e.g. a string literal. returns InvalidQuery once the frame's
+    // queries are used up; End ignores it
+    std::uint32_t Begin(const char* name);
+    void End(std::uint32_t query);
+
+    // may be null; takes effect at the next BeginFrame. sampling reads every thread's counters
+    // at both ends of each range, so it costs a few microseconds per range
+    void SetHardwareCounters(HardwareCounters* counters) { m_Counters = counters; }
+    HardwareCounters* GetHardwareCounters() const { return m_Counters; }
+
+    // the frame being recorded; 1 after the first BeginFrame
+    std::uint64_t GetFrameIndex() const { return m_FrameIndex; }
+
+    // ranges of the frame recorded framesInFlight frames ago, in submission order
+    const std::vector<Result>& GetResults() const { return m_Results; }
+
+    // the frame GetResults belongs to; 0 until the first frame resolved
+    std::uint64_t GetResultFrame() const { return m_ResultFrame; }
+
+    // per-thread breakdown of GetResults()[result].Counters, indexed like the HardwareCounters
+    // threads that existed when the frame was recorded
+    std::uint32_t GetResultThreadCount() const { return m_ResultThreadCount; }
+    const CounterValues& GetThreadCounters(std::uint32_t result, std::uint32_t thread) const {
+        return m_ThreadResults[(std::size_t)result * m_ResultThreadCount + thread];
+    }
+
+private:
+    struct Query {
+        const char* Name;
+        Clock::time_point Begin, End;
+    };
+
+    struct Frame {
+        std::uint64_t Index;
+        std::uint32_t Count;
+        std::vector<Query> Queries;
+
+        // running totals at the beginning and end of each query, ThreadCount per sample
+        HardwareCounters* Counters;
+        std::uint32_t ThreadCount;
+        std::vector<CounterValues> Samples;
+    };
+
+    CounterValues* GetSample(Frame& frame, std::uint32_t query, bool end) {
+        return frame.Samples.data() + ((std::size_t)query * 2 + (end ? 1 : 0)) * frame.ThreadCount;
+    }
+
+    void ResolveFrame(Frame& frame);
+
+    std::uint32_t m_QueriesPerFrame;
+    std::vector<Frame> m_Frames;
+    std::uint64_t m_FrameIndex;
+
+    HardwareCounters* m_Counters;
+
+    std::vector<Result> m_Results;
+    std::uint64_t m_ResultFrame;
+
+    std::uint32_t m_ResultThreadCount;
+    std::vector<CounterValues> m_ThreadResults;
+};
+
+// times the enclosing scope
+class TimestampScope {
+public:
+    TimestampScope(TimestampQueryPool& pool, const char* name) : m_Pool(pool) {
+        m_Query = pool.Begin(name);
+    }
+
+    ~TimestampScope() { m_Pool.End(m_Query); }
+
+    TimestampScope(const TimestampScope&) = delete;
+    TimestampScope& operator=(const TimestampScope&) = delete;
+
+private:
+    TimestampQueryPool& m_Pool;
+    std::uint32_t m_Query;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+
+#include <cstdint>
+
+// three copies of T shared by one writer thread and one reader thread, e.g. instance data written
+// by a simulation and drawn by the renderer. the writer fills its buffer in place and publishes
+// it; the reader acquires the latest published buffer and keeps reading it undisturbed until it
+// acquires again. neither side waits or copies, so both can run at their own rate. a buffer holds
+// whatever was written into it last, which is a few publishes old, so the writer rewrites it whole
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() {
+        m_Write = 0;
+        m_Shared.store(1, std::memory_order_relaxed);
+        m_Read = 2;
+    }
+
+    // every buffer starts as a copy of initial, so the reader has something before the first
+    // publish
+    TripleBuffer(const T& initial) : TripleBuffer() {
+        for (auto& buffer : m_Buffers) {
+            buffer.Value = initial;
+        }
+    }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // writer only. stays the writer's until Publish
+    T& GetWriteBuffer() { return m_Buffers[m_Write].Value; }
+
+    // writer only. hands the write buffer over to the reader and takes the one the reader has
+    // not acquired, or has already let go of
+    void Publish() {
+        std::uint32_t old = m_Shared.exchange(m_Write | s_Fresh, std::memory_order_acq_rel);
+        m_Write = old & s_IndexMask;
+    }
+
+    // reader only. switches to the newest published buffer if there is one; the result stays
+    // valid and unchanged until the next Acquire
+    const T& Acquire() {
+        if (m_Shared.load(std::memory_order_relaxed) & s_Fresh) {
+            std::uint32_t old = m_Shared.exchange(m_Read, std::memory_order_acq_rel);
+            m_Read = old & s_IndexMask;
+        }
+
+        return m_Buffers[m_Read].Value;
+    }
+
+    // reader only. whether a publish happened since the last Acquire
+    bool HasUpdate() const { return (m_Shared.load(std::memory_order_relaxed) & s_Fresh) != 0; }
+
+private:
+    static constexpr std::uint32_t s_IndexMask = 3;
+    static constexpr std::uint32_t s_Fresh = 4;
+
+    // the writer and reader touch different buffers all the time; a line each keeps them apart
+    struct alignas(64) Buffer {
+        T Value;
+    };
+
+    Buffer m_Buffers[3];
+
+    // the buffer between the two sides, plus s_Fresh while it holds a publish the reader has not
+    // acquired yet
+    alignas(64) std::atomic<std::uint32_t> m_Shared;
+
+    // each owned by one side
+    alignas(64) std::uint32_t m_Write;
+    alignas(64) std::uint32_t m_Read;
+};
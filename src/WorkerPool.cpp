@@ -0,0 +1,442 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <string>
+
+#include <cstdio>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <linux/mempolicy.h>
+#endif
+
+// roughly tens of microseconds; about as long as the gaps between dispatches within a frame
+static constexpr std::uint32_t s_SpinIterations = 4096;
+
+static constexpr std::uint64_t s_Open = 1ull << 63;
+
+static inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// node of every cpu, -1 for cpus no node lists; empty without numa information
+static std::vector<int> ReadCpuNodes() {
+    std::vector<int> nodes;
+
+#ifdef __linux__
+    DIR* dir = opendir("/sys/devices/system/node");
+    if (dir == nullptr) {
+        return nodes;
+    }
+
+    while (dirent* entry = readdir(dir)) {
+        int node;
+        if (std::sscanf(entry->d_name, "node%d", &node) != 1) {
+            continue;
+        }
+
+        std::ifstream stream("/sys/devices/system/node/" + std::string(entry->d_name) +
+                             "/cpulist");
+
+        // e.g. 0-15,32-47
+        std::string list;
+        std::getline(stream, list);
+
+        std::size_t start = 0;
+        while (start < list.size()) {
+            std::size_t end = list.find(',', start);
+            if (end == std::string::npos) {
+                end = list.size();
+            }
+
+            std::uint32_t first, last;
+            int fields = std::sscanf(list.c_str() + start, "%u-%u", &first, &last);
+
+            if (fields == 1) {
+                last = first;
+            }
+
+            for (std::uint32_t cpu = first; fields >= 1 && cpu <= last; cpu++) {
+                if (nodes.size() <= cpu) {
+                    nodes.resize(cpu + 1, -1);
+                }
+
+                nodes[cpu] = node;
+            }
+
+            start = end + 1;
+        }
+    }
+
+    closedir(dir);
+#endif
+
+    return nodes;
+}
+
+static const std::vector<int>& GetCpuNodes() {
+    static const std::vector<int> cpuNodes = ReadCpuNodes();
+    return cpuNodes;
+}
+
+#ifdef __linux__
+static bool BindPages(std::uintptr_t begin, std::uintptr_t end, int mode, unsigned long nodes) {
+    if (end <= begin) {
+        return true;
+    }
+
+    // MPOL_MF_MOVE also migrates pages that were touched already
+    return syscall(SYS_mbind, begin, end - begin, mode, &nodes, sizeof(nodes) * 8 + 1,
+                   MPOL_MF_MOVE) == 0;
+}
+#endif
+
+const char* GetWaitPolicyName(WaitPolicy policy) {
+    switch (policy) {
+    case WaitPolicy::Spin:
+        return "Spin";
+    case WaitPolicy::SpinThenWait:
+        return "Spin, then wait";
+    case WaitPolicy::Block:
+        return "Block";
+    default:
+        return "Unknown";
+    }
+}
+
+WorkerPool::WorkerPool(std::uint32_t workerCount, WaitPolicy policy) {
+    if (workerCount == 0) {
+        std::uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    m_Policy = policy;
+    m_Generation = 0;
+    m_State = 0;
+    m_Stop.store(false, std::memory_order_relaxed);
+
+    m_Task = nullptr;
+    m_Context = nullptr;
+    m_Tag = AllocationTag::Untagged;
+
+    m_Shares = std::make_unique<Share[]>(workerCount + 1);
+    for (std::uint32_t i = 0; i <= workerCount; i++) {
+        m_Shares[i].Next = m_Shares[i].End = 0;
+    }
+
+    m_Workers.reserve(workerCount);
+    for (std::uint32_t i = 0; i < workerCount; i++) {
+        m_Workers.emplace_back([this, i]() { WorkerLoop(i + 1); });
+    }
+
+    UpdateTopology();
+}
+
+WorkerPool::~WorkerPool() {
+    m_Stop.store(true, std::memory_order_release);
+
+    m_Generation.fetch_add(1, std::memory_order_release);
+    m_Generation.notify_all();
+
+    for (auto& worker : m_Workers) {
+        worker.join();
+    }
+}
+
+bool WorkerPool::SetAffinity(const std::vector<std::uint32_t>& cores) {
+#ifdef __linux__
+    // CPU_SET writes past the fixed-size set for anything larger
+    for (std::uint32_t core : cores) {
+        if (core >= CPU_SETSIZE) {
+            return false;
+        }
+    }
+#endif
+
+    std::lock_guard lock(m_DispatchMutex);
+    m_Affinity = cores;
+
+#ifdef __linux__
+    // unpinned workers get whatever the calling thread may run on
+    cpu_set_t anywhere;
+    if (sched_getaffinity(0, sizeof(anywhere), &anywhere) != 0) {
+        return false;
+    }
+
+    bool succeeded = true;
+    for (std::size_t i = 0; i < m_Workers.size(); i++) {
+        cpu_set_t set = anywhere;
+
+        if (!cores.empty()) {
+            CPU_ZERO(&set);
+            CPU_SET(cores[i % cores.size()], &set);
+        }
+
+        if (pthread_setaffinity_np(m_Workers[i].native_handle(), sizeof(set), &set) != 0) {
+            succeeded = false;
+        }
+    }
+
+    UpdateTopology();
+    return succeeded;
+#else
+    return cores.empty();
+#endif
+}
+
+std::vector<std::uint32_t> WorkerPool::GetPhysicalCores() {
+    std::vector<std::uint32_t> cores;
+
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return cores;
+    }
+
+    // siblings list the same set for every logical cpu of a core; the first allowed cpu to name
+    // a set stands in for the core
+    std::set<std::string> seen;
+    for (std::uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+
+        std::ifstream stream("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                             "/topology/thread_siblings_list");
+
+        std::string siblings;
+        if (!std::getline(stream, siblings)) {
+            return {};
+        }
+
+        if (seen.insert(siblings).second) {
+            cores.push_back(cpu);
+        }
+    }
+#endif
+
+    return cores;
+}
+
+std::uint32_t WorkerPool::GetNodeCount() {
+    int maxNode = 0;
+    for (int node : GetCpuNodes()) {
+        maxNode = std::max(maxNode, node);
+    }
+
+    return (std::uint32_t)maxNode + 1;
+}
+
+bool WorkerPool::PlaceRows(void* data, std::size_t rowBytes, std::uint32_t rows) const {
+#ifdef __linux__
+    std::uint32_t nodeCount = std::min<std::uint32_t>(GetNodeCount(), sizeof(unsigned long) * 8);
+    if (nodeCount < 2 || data == nullptr) {
+        return true;
+    }
+
+    // whole pages only; the partial pages at either end stay where they are
+    std::uintptr_t pageSize = (std::uintptr_t)sysconf(_SC_PAGESIZE);
+    auto pageDown = [&](std::uintptr_t address) { return address & ~(pageSize - 1); };
+    auto pageUp = [&](std::uintptr_t address) { return pageDown(address + pageSize - 1); };
+
+    auto begin = (std::uintptr_t)data;
+    auto end = begin + rowBytes * rows;
+
+    bool nodesKnown = std::none_of(m_Nodes.begin(), m_Nodes.end(), [](int n) { return n < 0; });
+    if (!nodesKnown) {
+        unsigned long allNodes = nodeCount == sizeof(unsigned long) * 8 ? ~0ul
+                                                                        : (1ul << nodeCount) - 1;
+
+        return BindPages(pageUp(begin), pageDown(end), MPOL_INTERLEAVE, allNodes);
+    }
+
+    // the same proportional split Dispatch hands out
+    bool succeeded = true;
+    std::uint64_t participants = GetThreadCount();
+
+    for (std::uint64_t i = 0; i < participants; i++) {
+        std::uintptr_t shareBegin = begin + rows * i / participants * rowBytes;
+        std::uintptr_t shareEnd = begin + rows * (i + 1) / participants * rowBytes;
+
+        if (!BindPages(pageUp(shareBegin), pageUp(std::min(shareEnd, pageDown(end))),
+                       MPOL_PREFERRED, 1ul << m_Nodes[i])) {
+            succeeded = false;
+        }
+    }
+
+    return succeeded;
+#else
+    return true;
+#endif
+}
+
+void WorkerPool::UpdateTopology() {
+    std::uint32_t participants = GetThreadCount();
+    const auto& cpuNodes = GetCpuNodes();
+
+    // the caller is not pinned; its node only counts while the workers are
+    m_Nodes.assign(participants, -1);
+    if (!m_Affinity.empty()) {
+        for (std::uint32_t i = 1; i < participants; i++) {
+            std::uint32_t cpu = m_Affinity[(i - 1) % m_Affinity.size()];
+            m_Nodes[i] = cpu < cpuNodes.size() ? cpuNodes[cpu] : -1;
+        }
+
+#ifdef __linux__
+        int cpu = sched_getcpu();
+        m_Nodes[0] = cpu >= 0 && (std::size_t)cpu < cpuNodes.size() ? cpuNodes[cpu] : -1;
+#endif
+    }
+
+    m_StealOrder.resize(participants);
+    for (std::uint32_t i = 0; i < participants; i++) {
+        auto& order = m_StealOrder[i];
+        order.clear();
+
+        // starting from the next participant spreads the thieves over different victims
+        for (std::uint32_t j = 1; j < participants; j++) {
+            order.push_back((i + j) % participants);
+        }
+
+        int node = m_Nodes[i];
+        std::stable_partition(order.begin(), order.end(), [&](std::uint32_t victim) {
+            return node >= 0 && m_Nodes[victim] == node;
+        });
+    }
+}
+
+void WorkerPool::WaitWhileEqual(const std::atomic<std::uint64_t>& value,
+                                std::uint64_t old) const {
+    WaitPolicy policy = m_Policy.load(std::memory_order_relaxed);
+
+    if (policy != WaitPolicy::Block) {
+        for (std::uint32_t i = 0; policy == WaitPolicy::Spin || i < s_SpinIterations; i++) {
+            if (value.load(std::memory_order_acquire) != old) {
+                return;
+            }
+
+            CpuRelax();
+
+            // a policy change reaches workers that are spinning right now, too
+            if (i % 1024 == 1023) {
+                policy = m_Policy.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    while (value.load(std::memory_order_acquire) == old) {
+        value.wait(old, std::memory_order_acquire);
+    }
+}
+
+void WorkerPool::Dispatch(std::uint32_t count, Task task, const void* context) {
+    if (count == 0) {
+        return;
+    }
+
+    std::lock_guard lock(m_DispatchMutex);
+
+    if (count == 1 || m_Workers.empty()) {
+        for (std::uint32_t i = 0; i < count; i++) {
+            task(context, i, 0);
+        }
+
+        return;
+    }
+
+    // the previous dispatch closed with no worker inside, so none of them reads these right now
+    m_Task = task;
+    m_Context = context;
+    m_Tag = AllocationTracker::GetCurrentTag();
+
+    std::uint64_t participants = GetThreadCount();
+    for (std::uint64_t i = 0; i < participants; i++) {
+        auto& share = m_Shares[i];
+        share.Next.store((std::uint32_t)(count * i / participants), std::memory_order_relaxed);
+        share.End = (std::uint32_t)(count * (i + 1) / participants);
+    }
+
+    m_State.store(s_Open, std::memory_order_release);
+    m_Generation.fetch_add(1, std::memory_order_release);
+    m_Generation.notify_all();
+
+    RunJobs(0);
+
+    // every index has been claimed at this point; wait for the workers still running one
+    std::uint64_t state = m_State.fetch_and(~s_Open, std::memory_order_acq_rel) & ~s_Open;
+    while (state != 0) {
+        WaitWhileEqual(m_State, state);
+        state = m_State.load(std::memory_order_acquire);
+    }
+}
+
+void WorkerPool::RunJobs(std::uint32_t participant) {
+    RunRange(participant, participant);
+
+    for (std::uint32_t victim : m_StealOrder[participant]) {
+        RunRange(victim, participant);
+    }
+}
+
+void WorkerPool::RunRange(std::uint32_t owner, std::uint32_t participant) {
+    auto& share = m_Shares[owner];
+
+    while (true) {
+        std::uint32_t index = share.Next.fetch_add(1, std::memory_order_relaxed);
+        if (index >= share.End) {
+            break;
+        }
+
+        m_Task(m_Context, index, participant);
+    }
+}
+
+void WorkerPool::WorkerLoop(std::uint32_t participant) {
+    std::uint64_t seenGeneration = 0;
+
+    while (true) {
+        WaitWhileEqual(m_Generation, seenGeneration);
+        seenGeneration = m_Generation.load(std::memory_order_acquire);
+
+        if (m_Stop.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        std::uint64_t state = m_State.load(std::memory_order_acquire);
+        bool joined = false;
+
+        while ((state & s_Open) != 0 && !joined) {
+            joined = m_State.compare_exchange_weak(state, state + 1, std::memory_order_acquire);
+        }
+
+        if (!joined) {
+            continue;
+        }
+
+        // no later dispatch can start while this worker is inside, so this is the generation it
+        // joined
+        seenGeneration = m_Generation.load(std::memory_order_acquire);
+
+        {
+            // jobs allocate on behalf of whoever dispatched them
+            AllocationScope scope(m_Tag);
+            RunJobs(participant);
+        }
+
+        // the last worker out of a closed dispatch wakes the caller
+        if (m_State.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            m_State.notify_one();
+        }
+    }
+}
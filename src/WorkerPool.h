@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <cstdint>
+
+#include "AllocationTracker.h"
+
+// how idle workers wait for the next dispatch
+enum class WaitPolicy {
+    // never sleeps; the lowest wake-up latency, but every worker keeps a core busy between jobs
+    Spin,
+
+    // spins for a few microseconds, then sleeps on a futex
+    SpinThenWait,
+
+    // sleeps right away; nothing runs between jobs, each dispatch pays the wake-up
+    Block,
+};
+
+static constexpr std::uint32_t s_WaitPolicyCount = 3;
+
+const char* GetWaitPolicyName(WaitPolicy policy);
+
+// fixed set of threads that split index ranges between themselves and the calling thread. each
+// thread owns a contiguous share of every range and only takes other shares once its own is done,
+// nearest numa node first, so a row keeps running on the same thread from frame to frame. any
+// thread may dispatch; dispatches from several threads take turns, and whichever thread is
+// dispatching is thread 0 for the duration
+class WorkerPool {
+public:
+    // 0 spawns one worker per hardware thread, minus the calling thread
+    WorkerPool(std::uint32_t workerCount = 0, WaitPolicy policy = WaitPolicy::SpinThenWait);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // threads that take part in ParallelFor, including the caller
+    std::uint32_t GetThreadCount() const { return (std::uint32_t)m_Workers.size() + 1; }
+
+    // applies from the next wait on; the calling thread follows it too while waiting for workers
+    void SetWaitPolicy(WaitPolicy policy) { m_Policy.store(policy, std::memory_order_relaxed); }
+    WaitPolicy GetWaitPolicy() const { return m_Policy.load(std::memory_order_relaxed); }
+
+    // pins worker i to cores[i % size]; empty lets every worker run anywhere again. returns false
+    // if the os refused a core, or without changing anything if a core is CPU_SETSIZE or above.
+    // pinned workers are known to sit on their core's numa node. waits for a running dispatch to
+    // finish
+    bool SetAffinity(const std::vector<std::uint32_t>& cores);
+    const std::vector<std::uint32_t>& GetAffinity() const { return m_Affinity; }
+
+    // one logical cpu per physical core this process may run on, so workers pinned to them never
+    // share a core with an smt sibling. empty if the topology is unknown
+    static std::vector<std::uint32_t> GetPhysicalCores();
+
+    // 1 on machines without numa, or when the topology is unknown
+    static std::uint32_t GetNodeCount();
+
+    // moves the pages of an image of rows rows onto the nodes of the threads that own them in
+    // ParallelFor, give or take one job's rounding. with unpinned workers the owners' nodes are
+    // unknown, so the pages are interleaved over every node instead. does nothing without numa;
+    // returns false if the kernel refused
+    bool PlaceRows(void* data, std::size_t rowBytes, std::uint32_t rows) const;
+
+    // calls func(i) for every i in [0, count) and blocks until all calls returned, after any
+    // dispatch from another thread. not reentrant; func must not call ParallelFor itself
+    template <typename Func>
+    void ParallelFor(std::uint32_t count, const Func& func) {
+        Dispatch(
+            count,
+            [](const void* context, std::uint32_t index, std::uint32_t) {
+                (*(const Func*)context)(index);
+            },
+            &func);
+    }
+
+    // like ParallelFor, but calls func(i, thread) with the index of the thread running the call,
+    // in [0, GetThreadCount()). 0 is the caller. no two calls with the same thread index overlap,
+    // so per-thread state can be indexed by it
+    template <typename Func>
+    void ParallelForThreads(std::uint32_t count, const Func& func) {
+        Dispatch(
+            count,
+            [](const void* context, std::uint32_t index, std::uint32_t thread) {
+                (*(const Func*)context)(index, thread);
+            },
+            &func);
+    }
+
+private:
+    // type-erased without std::function so dispatching never allocates
+    using Task = void (*)(const void* context, std::uint32_t index, std::uint32_t thread);
+
+    // serialized by m_DispatchMutex
+    void Dispatch(std::uint32_t count, Task task, const void* context);
+
+    // the caller is participant 0, worker i is participant i + 1
+    void RunJobs(std::uint32_t participant);
+    void RunRange(std::uint32_t owner, std::uint32_t participant);
+    void WorkerLoop(std::uint32_t participant);
+
+    // rebuilds m_Nodes and m_StealOrder after the affinity changed
+    void UpdateTopology();
+
+    // waits until value differs from old, the way the current policy says
+    void WaitWhileEqual(const std::atomic<std::uint64_t>& value, std::uint64_t old) const;
+
+    std::vector<std::thread> m_Workers;
+
+    // held for a whole dispatch, so callers on different threads never share the state below
+    std::mutex m_DispatchMutex;
+
+    std::vector<std::uint32_t> m_Affinity;
+    std::atomic<WaitPolicy> m_Policy;
+
+    // bumped once per dispatch; workers wait on it between jobs
+    std::atomic<std::uint64_t> m_Generation;
+
+    // s_Open while a dispatch takes new workers, plus the number of workers inside it. a worker
+    // that wakes up after the dispatch closed skips it, so the caller never waits for stragglers
+    // and the next dispatch never sets up while one is still scanning indices
+    std::atomic<std::uint64_t> m_State;
+
+    // workers may still be waking up from an earlier generation when the destructor sets it
+    std::atomic<bool> m_Stop;
+
+    Task m_Task;
+    const void* m_Context;
+    AllocationTag m_Tag;
+
+    // one share of the current range per participant
+    struct alignas(64) Share {
+        std::atomic<std::uint32_t> Next;
+        std::uint32_t End;
+    };
+
+    std::unique_ptr<Share[]> m_Shares;
+
+    // numa node per participant, -1 if unknown, and the order each participant visits the other
+    // shares in: same node first
+    std::vector<int> m_Nodes;
+    std::vector<std::vector<std::uint32_t>> m_StealOrder;
+};
@@ -4,8 +4,19 @@
 #include <stdexcept>
 #include <numbers>
 #include <chrono>
-
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <exception>
+
+#include <cassert>
+#include <cfloat>
 #include <cstdint>
+#include <cstdlib>
+
+#include <pthread.h>
 
 #include <imgui.h>
 
@@ -22,6 +33,25 @@ extern "C" {
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Rasterizer.h"
+#include "RenderScheduler.h"
+#include "WorkerPool.h"
+#include "PostProcess.h"
+#include "TimestampQuery.h"
+#include "HardwareCounters.h"
+#include "Benchmark.h"
+#include "AllocationTracker.h"
+#include "MemoryBudget.h"
+#include "FrameTimeRecorder.h"
+#include "SlowFrameCapture.h"
+#include "SamplingProfiler.h"
+#include "LatencyRecorder.h"
+#include "LateLatch.h"
+#include "InputThread.h"
+#include "FramePacer.h"
+#include "HugePages.h"
+#include "TripleBuffer.h"
+
 class Window {
 public:
     static std::unique_ptr<Window> Create(const std::string& title, std::uint32_t width,
@@ -34,18 +64,14 @@ public:
         return std::unique_ptr<Window>(new Window(window));
     }
 
-    static void Poll() { window_poll(); }
-
     ~Window() { window_destroy(m_Window); }
 
     Window(const Window&) = delete;
     Window& operator=(const Window&) = delete;
 
-    bool IsCloseRequested() const { return window_is_close_requested(m_Window); }
-
-    void SwapBuffers() { window_swap_buffers(m_Window); }
+    window_t* Get() { return m_Window; }
 
-    image_t* GetBackbuffer() { return window_get_backbuffer(m_Window); }
+    bool IsCloseRequested() const { return window_is_close_requested(m_Window); }
 
     void GetFramebufferSize(std::uint32_t* width, std::uint32_t* height) const {
         window_get_framebuffer_size(m_Window, width, height);
@@ -59,46 +85,6 @@ private:
     window_t* m_Window;
 };
 
-#ifndef NDEBUG
-static constexpr bool s_IsDebug = true;
-#else
-static constexpr bool s_IsDebug = false;
-#endif
-
-class Rasterizer {
-public:
-    static std::shared_ptr<Rasterizer> Create() {
-        rasterizer_t* rast = rasterizer_create(!s_IsDebug);
-        if (rast == nullptr) {
-            return nullptr;
-        }
-
-        return std::shared_ptr<Rasterizer>(new Rasterizer(rast));
-    }
-
-    ~Rasterizer() { rasterizer_destroy(m_Rasterizer); }
-
-    Rasterizer(const Rasterizer&) = delete;
-    Rasterizer& operator=(const Rasterizer&) = delete;
-
-    rasterizer_t* Get() { return m_Rasterizer; }
-
-    void ClearFramebuffer(framebuffer* fb, const std::vector<image_pixel>& clearValues) const {
-        if (clearValues.size() != fb->attachment_count) {
-            throw std::runtime_error("Attachment size mismatch!");
-        }
-
-        framebuffer_clear(m_Rasterizer, fb, clearValues.data());
-    }
-
-    void RenderIndexed(indexed_render_call& call) const { render_indexed(m_Rasterizer, &call); }
-
-private:
-    Rasterizer(rasterizer_t* rast) { m_Rasterizer = rast; }
-
-    rasterizer_t* m_Rasterizer;
-};
-
 class ImGuiRenderer {
 public:
     ImGuiRenderer(const std::shared_ptr<Rasterizer>& rast) {
@@ -131,6 +117,8 @@ struct Instance {
     std::uint32_t Color;
 };
 
+using Instances = std::array<Instance, 6>;
+
 struct WorkingData {
     std::uint32_t Color;
 };
@@ -181,7 +169,86 @@ static std::uint32_t FragmentShader(const shader_context* context) {
     return workingData->Color;
 }
 
-static bool IsDepthBufferValid(image_t* buffer, std::uint32_t width, std::uint32_t height) {
+// the cube's faces, each pushed out along its normal by spread
+static void WriteInstances(Instances& instances, float spread) {
+    for (std::size_t i = 0; i < instances.size(); i++) {
+        auto& instance = instances[i];
+
+        bool negative = i % 2 == 0;
+        std::size_t primaryAxis = i / 2;
+
+        uint8_t colorValue = negative ? 0x7F : 0xFF;
+        instance.Color = (colorValue << ((primaryAxis + 1) * 8)) | 0xFF;
+
+        std::size_t secondaryAxis = (primaryAxis + 1) % 3;
+        std::size_t tertiaryAxis = (primaryAxis + 2) % 3;
+        float axisValue = negative ? -1.f : 1.f;
+
+        glm::mat4 rotation(0.f);
+        rotation[0][secondaryAxis] = axisValue;
+        rotation[1][tertiaryAxis] = 1.f;
+        rotation[2][primaryAxis] = axisValue;
+
+        glm::mat4 scale = glm::scale(glm::mat4(1.f), glm::vec3(0.25f));
+        glm::mat4 translation =
+            glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, -0.5f - spread));
+
+        instance.Model = scale * rotation * translation;
+    }
+}
+
+// instance updates per second, independent of the frame rate
+static constexpr double s_SimulationRate = 120.0;
+
+// writes the scene's instances on a thread of its own at a fixed rate and publishes each set;
+// the renderer draws whichever set was published last
+class InstanceSimulation {
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    InstanceSimulation(TripleBuffer<Instances>& instances, double rate) : m_Instances(instances) {
+        m_Period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / rate));
+
+        m_Stop = false;
+        m_Thread = std::thread([this]() { Run(); });
+    }
+
+    ~InstanceSimulation() {
+        m_Stop.store(true, std::memory_order_release);
+        m_Thread.join();
+    }
+
+    InstanceSimulation(const InstanceSimulation&) = delete;
+    InstanceSimulation& operator=(const InstanceSimulation&) = delete;
+
+private:
+    void Run() {
+        pthread_setname_np(pthread_self(), "simulation");
+
+        auto start = Clock::now();
+        auto next = start;
+
+        while (!m_Stop.load(std::memory_order_acquire)) {
+            float time = std::chrono::duration<float>(Clock::now() - start).count();
+
+            // the faces drift apart and back together every few seconds
+            WriteInstances(m_Instances.GetWriteBuffer(), 0.1f * (1.f - glm::cos(time)));
+            m_Instances.Publish();
+
+            next += m_Period;
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    TripleBuffer<Instances>& m_Instances;
+    Clock::duration m_Period;
+
+    std::atomic<bool> m_Stop;
+    std::thread m_Thread;
+};
+
+static bool IsAttachmentValid(image_t* buffer, std::uint32_t width, std::uint32_t height) {
     if (!buffer) {
         return false;
     }
@@ -189,16 +256,181 @@ static bool IsDepthBufferValid(image_t* buffer, std::uint32_t width, std::uint32
     return buffer->width == width && buffer->height == height;
 }
 
-static void ValidateDepthBuffer(const Window& window, image_t** buffer) {
-    std::uint32_t width, height;
-    window.GetFramebufferSize(&width, &height);
-
-    if (!IsDepthBufferValid(*buffer, width, height)) {
+static void ValidateAttachment(std::uint32_t width, std::uint32_t height, image_format format,
+                               image_t** buffer) {
+    if (!IsAttachmentValid(*buffer, width, height)) {
         image_free(*buffer);
-        *buffer = image_allocate(width, height, IMAGE_FORMAT_DEPTH);
+
+        // a minimized window has no area to allocate
+        *buffer = width > 0 && height > 0 ? image_allocate(width, height, format) : nullptr;
+    }
+}
+
+static void* ImGuiAllocate(std::size_t size, void* userData) {
+    AllocationScope scope(AllocationTag::UI);
+    return std::malloc(size);
+}
+
+static void ImGuiFree(void* block, void* userData) { std::free(block); }
+
+static WaitPolicy ParseWaitPolicy(const std::string& name) {
+    if (name == "spin") {
+        return WaitPolicy::Spin;
+    } else if (name == "spin-wait") {
+        return WaitPolicy::SpinThenWait;
+    } else if (name == "block") {
+        return WaitPolicy::Block;
     }
+
+    throw std::runtime_error("unknown wait policy: " + name);
 }
 
+static HugePageMode ParseHugePageMode(const std::string& name) {
+    if (name == "off") {
+        return HugePageMode::Off;
+    } else if (name == "transparent") {
+        return HugePageMode::Transparent;
+    } else if (name == "explicit") {
+        return HugePageMode::Explicit;
+    }
+
+    throw std::runtime_error("unknown huge page mode: " + name);
+}
+
+static std::vector<std::uint32_t> ParseCoreList(const std::string& list) {
+    if (list == "physical") {
+        return WorkerPool::GetPhysicalCores();
+    }
+
+    std::vector<std::uint32_t> cores;
+    std::size_t start = 0;
+
+    while (start < list.size()) {
+        std::size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+
+        cores.push_back((std::uint32_t)std::stoul(list.substr(start, end - start)));
+        start = end + 1;
+    }
+
+    return cores;
+}
+
+// whether the user did anything since the last frame; valid after NewFrame
+static bool HasInputActivity() {
+    const ImGuiIO& io = ImGui::GetIO();
+    if (io.MouseDelta.x != 0.f || io.MouseDelta.y != 0.f) {
+        return true;
+    }
+
+    if (io.MouseWheel != 0.f || io.MouseWheelH != 0.f) {
+        return true;
+    }
+
+    for (bool down : io.MouseDown) {
+        if (down) {
+            return true;
+        }
+    }
+
+    return io.InputQueueCharacters.Size > 0 || ImGui::IsAnyItemActive();
+}
+
+// frames without a resize or ui interaction before the render loop must stop allocating
+static constexpr std::uint32_t s_AllocationWarmupFrames = 120;
+
+static constexpr std::uint32_t s_MaxBloomDownscale = 16;
+
+// frames within budget in a row before a step is undone, and how far below its budget, and below
+// the container limit, the usage it stepped away from has to be
+static constexpr std::uint32_t s_RestoreFrames = 120;
+static constexpr double s_RestoreThreshold = 0.8;
+
+// steps post-processing down by one level per frame while it is over budget: bloom at half the
+// resolution until it hits the limit, then no bloom. the settings the user picked stay untouched;
+// Apply derives what actually runs from them. a step is undone once the budget has held for a
+// while and the usage recorded when the step was taken fits with room to spare, so a budget that
+// was raised or pressure that went away gives the quality back without bouncing at the edge
+class MemoryDegradation {
+public:
+    MemoryDegradation() {
+        m_Steps = 0;
+        m_CalmFrames = 0;
+    }
+
+    MemoryDegradation(const MemoryDegradation&) = delete;
+    MemoryDegradation& operator=(const MemoryDegradation&) = delete;
+
+    PostProcessSettings Apply(const PostProcessSettings& settings) const {
+        PostProcessSettings applied = settings;
+
+        for (std::uint32_t i = 0; i < m_Steps && applied.Bloom; i++) {
+            if (applied.BloomDownscale < s_MaxBloomDownscale) {
+                applied.BloomDownscale = std::max(applied.BloomDownscale, 2u) * 2;
+            } else {
+                applied.Bloom = false;
+            }
+        }
+
+        return applied;
+    }
+
+    // call after the frame's usage was recorded. returns whether the applied settings changed
+    bool Update(const MemoryBudget& budget, const PostProcessSettings& settings) {
+        std::size_t usage = budget.GetUsage(MemoryCategory::PostProcess);
+
+        if (budget.IsOverBudget(MemoryCategory::PostProcess)) {
+            m_CalmFrames = 0;
+
+            if (!Apply(settings).Bloom) {
+                return false;
+            }
+
+            m_LeftUsage.push_back(usage);
+            m_Steps++;
+            return true;
+        }
+
+        if (m_Steps == 0 || ++m_CalmFrames < s_RestoreFrames) {
+            return false;
+        }
+
+        std::size_t restored = m_LeftUsage.back();
+        std::size_t limit = budget.GetBudget(MemoryCategory::PostProcess);
+        if (limit > 0 && (double)restored >= (double)limit * s_RestoreThreshold) {
+            return false;
+        }
+
+        std::size_t containerLimit = budget.GetContainerLimit();
+        std::size_t growth = restored > usage ? restored - usage : 0;
+        if (containerLimit > 0 && (double)(budget.GetResidentBytes() + growth) >=
+                                      (double)containerLimit * s_RestoreThreshold) {
+            return false;
+        }
+
+        m_LeftUsage.pop_back();
+        m_Steps--;
+        m_CalmFrames = 0;
+        return true;
+    }
+
+    // the recorded usage only holds for the size it was measured at
+    void Forget() {
+        m_LeftUsage.clear();
+        m_Steps = 0;
+        m_CalmFrames = 0;
+    }
+
+private:
+    std::uint32_t m_Steps;
+    std::uint32_t m_CalmFrames;
+
+    // post-processing usage right before each step was taken
+    std::vector<std::size_t> m_LeftUsage;
+};
+
 static glm::mat4 LookAt(const glm::vec3& eye, const glm::vec3& center, const glm::vec3& up) {
     glm::vec3 forward = glm::normalize(center - eye);
     glm::vec3 right = glm::normalize(glm::cross(forward, up));
@@ -218,17 +450,277 @@ static glm::mat4 LookAt(const glm::vec3& eye, const glm::vec3& center, const glm
     return glm::inverse(translation * rotation);
 }
 
-int main(int argc, const char** argv) {
-    auto rast = Rasterizer::Create();
-    auto window = Window::Create("Test", 1600, 900);
+// orbits the origin; theta advances with the animation
+static Uniforms ComputeCamera(float theta, std::uint32_t width, std::uint32_t height) {
+    float aspect = height > 0 ? (float)width / (float)height : 1.f;
 
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
+    float cosTheta = glm::cos(theta);
+    float sinTheta = glm::sin(theta);
 
-    window->InitImGui();
+    float phi = cosTheta * std::numbers::pi_v<float> / 4.f;
+    float cosPhi = glm::cos(phi);
+    float sinPhi = glm::sin(phi);
+
+    float cameraDistance = 10.f;
+
+    glm::vec3 eye = { cosTheta * cosPhi * cameraDistance, sinPhi * cameraDistance,
+                      sinTheta * cosPhi * cameraDistance };
+
+    static const glm::vec3 center = glm::vec3(0.f);
+    static const glm::vec3 up = glm::vec3(0.f, -1.f, 0.f);
+
+    Uniforms uniforms;
+    uniforms.Projection = glm::perspective(glm::radians(45.f), aspect, 0.1f, 100.f);
+    uniforms.View = LookAt(eye, center, up);
+
+    return uniforms;
+}
+
+// runs on the render thread; input runs the window on the main thread meanwhile
+static const std::vector<image_pixel> s_ClearValues = { { .color = 0x787878FF }, { .depth = 1.f } };
+
+// side length of an extra view, and the space between views and around the strip
+static constexpr std::uint32_t s_ViewSize = 128;
+static constexpr std::uint32_t s_ViewGap = 8;
+
+static constexpr int s_MaxViews = 8;
+
+// small extra views of the scene from angles spread around it. each is small enough for one
+// thread to render whole, so they are drawn side by side with Rasterizer::RenderBatch instead of
+// one after the other across every thread, then copied into a row of the frame
+class ViewStrip {
+public:
+    ViewStrip(std::uint32_t count) {
+        m_Images.resize(count * 2, nullptr);
+        m_Framebuffers.resize(count);
+        m_Cameras.resize(count);
+        m_Jobs.resize(count);
+
+        for (std::uint32_t i = 0; i < count; i++) {
+            image_t** images = &m_Images[i * 2];
+            images[0] = image_allocate(s_ViewSize, s_ViewSize, IMAGE_FORMAT_COLOR);
+            images[1] = image_allocate(s_ViewSize, s_ViewSize, IMAGE_FORMAT_DEPTH);
+
+            auto& fb = m_Framebuffers[i];
+            fb.width = fb.height = s_ViewSize;
+            fb.attachment_count = 2;
+            fb.attachments = images;
+
+            auto& job = m_Jobs[i];
+            job.Framebuffer = &fb;
+            job.ClearValues = s_ClearValues;
+            job.Calls.resize(1);
+        }
+
+        if (std::find(m_Images.begin(), m_Images.end(), nullptr) != m_Images.end()) {
+            FreeImages();
+            throw std::runtime_error("Failed to allocate a view!");
+        }
+    }
+
+    ~ViewStrip() { FreeImages(); }
+
+    ViewStrip(const ViewStrip&) = delete;
+    ViewStrip& operator=(const ViewStrip&) = delete;
+
+    std::uint32_t GetCount() const { return (std::uint32_t)m_Jobs.size(); }
+
+    // each view draws call, seen from its own angle around the scene starting at theta. call's
+    // vertex data must stay alive until the views were rendered
+    void Update(const indexed_render_call& call, float theta) {
+        for (std::uint32_t i = 0; i < GetCount(); i++) {
+            float angle = theta + 2.f * std::numbers::pi_v<float> * (float)i / (float)GetCount();
+            m_Cameras[i] = ComputeCamera(angle, s_ViewSize, s_ViewSize);
+
+            auto& viewCall = m_Jobs[i].Calls[0];
+            viewCall = call;
+            viewCall.uniform_data = &m_Cameras[i];
+        }
+    }
+
+    // one job per view, in view order
+    const std::vector<BatchJob>& GetJobs() const { return m_Jobs; }
+
+    // copies the views left to right into target, starting at row. views that do not fit whole
+    // are left out
+    void CopyTo(image_t* target, std::uint32_t row) const {
+        if (row + s_ViewSize > target->height) {
+            return;
+        }
+
+        for (std::uint32_t i = 0; i < GetCount(); i++) {
+            std::uint32_t x = s_ViewGap + i * (s_ViewSize + s_ViewGap);
+            if (x + s_ViewSize > target->width) {
+                break;
+            }
+
+            const image_t* view = m_Images[i * 2];
+            for (std::uint32_t y = 0; y < s_ViewSize; y++) {
+                memcpy(&target->data[(std::size_t)(row + y) * target->width + x],
+                       &view->data[(std::size_t)y * s_ViewSize], s_ViewSize * sizeof(image_pixel));
+            }
+        }
+    }
+
+private:
+    void FreeImages() {
+        for (image_t* image : m_Images) {
+            image_free(image);
+        }
+    }
+
+    // color and depth of view 0, then of view 1...
+    std::vector<image_t*> m_Images;
+    std::vector<framebuffer> m_Framebuffers;
+
+    std::vector<Uniforms> m_Cameras;
+    std::vector<BatchJob> m_Jobs;
+};
+
+// views per session, and how many sessions share the scheduler
+static constexpr std::uint32_t s_SessionViews = 4;
+static constexpr std::uint32_t s_SessionCount = 2;
+
+// a viewer of the scene with views of its own, e.g. a remote client, sharing the pool with the
+// others through a RenderContext. each view has at most one job queued, so no two threads ever
+// draw into the same view
+class Session {
+public:
+    Session(RenderScheduler& scheduler, std::uint32_t weight)
+        : m_Views(s_SessionViews), m_Context(scheduler, weight) {
+        m_Submitted = 0;
+    }
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    // call between the scheduler's Executes only. Execute returns with nothing running, and a
+    // context's jobs start in submission order, so the jobs that completed are exactly the oldest
+    // ones and every view after the queued ones is free to draw again
+    void Submit(const indexed_render_call& call, float theta) {
+        m_Views.Update(call, theta);
+
+        while (m_Submitted - m_Context.GetCompletedJobs() < m_Views.GetCount()) {
+            m_Context.Submit(m_Views.GetJobs()[m_Submitted % m_Views.GetCount()]);
+            m_Submitted++;
+        }
+    }
+
+    ViewStrip& GetViews() { return m_Views; }
+    RenderContext& GetContext() { return m_Context; }
+
+private:
+    ViewStrip m_Views;
+    RenderContext m_Context;
+
+    std::uint64_t m_Submitted;
+};
+
+static int RunRenderer(int argc, const char** argv, InputThread& input) {
+    // --benchmark <frames>: render a fixed number of frames with hardware counters on, then
+    // write the averages as json to --benchmark-output, or to stdout
+    // --frame-times <path>: write the frame time window as csv on exit
+    // --slow-frame-budget <ms>, --capture-dir <path>: dump a trace of frames slower than the
+    // budget into the directory
+    // --profile <path>: run the sampling profiler for the whole render loop and write collapsed
+    // stacks to path. without it, the Timings window starts and stops it into profile.folded
+    // --fps <rate>: frame limit, 0 for none. 60 by default, none when benchmarking
+    // --idle-after <frames>: stop rendering after this many frames without input or resizes
+    // --worker-wait <spin|spin-wait|block>: how post-processing workers wait between jobs
+    // --worker-cores <physical|list>: pin workers to one cpu per physical core, or to a comma
+    // separated list of cpus
+    // --huge-pages <off|transparent|explicit>: back attachments and large buffers with 2 MiB pages
+    std::unique_ptr<BenchmarkRecorder> benchmark;
+    std::string benchmarkPath, frameTimesPath, profilePath;
+    SlowFrameCapture slowFrames;
+
+    int frameRate = -1;
+    FramePacer pacer;
+
+    WaitPolicy workerWait = WaitPolicy::SpinThenWait;
+    std::vector<std::uint32_t> workerCores;
+
+    for (int i = 1; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 == argc) {
+            throw std::runtime_error("missing value for option: " + option);
+        }
+
+        if (option == "--benchmark") {
+            benchmark = std::make_unique<BenchmarkRecorder>((std::uint32_t)std::stoul(argv[i + 1]));
+        } else if (option == "--benchmark-output") {
+            benchmarkPath = argv[i + 1];
+        } else if (option == "--frame-times") {
+            frameTimesPath = argv[i + 1];
+        } else if (option == "--slow-frame-budget") {
+            slowFrames.SetBudget(std::stod(argv[i + 1]));
+        } else if (option == "--capture-dir") {
+            slowFrames.SetOutputDirectory(argv[i + 1]);
+        } else if (option == "--profile") {
+            profilePath = argv[i + 1];
+        } else if (option == "--fps") {
+            frameRate = std::stoi(argv[i + 1]);
+        } else if (option == "--idle-after") {
+            pacer.SetIdleFrames((std::uint32_t)std::stoul(argv[i + 1]));
+        } else if (option == "--worker-wait") {
+            workerWait = ParseWaitPolicy(argv[i + 1]);
+        } else if (option == "--worker-cores") {
+            workerCores = ParseCoreList(argv[i + 1]);
+        } else if (option == "--huge-pages") {
+            HugePages::SetMode(ParseHugePageMode(argv[i + 1]));
+        } else {
+            throw std::runtime_error("unknown option: " + option);
+        }
+    }
+
+    if (frameRate < 0) {
+        frameRate = benchmark ? 0 : 60;
+    }
+
+    pacer.SetTargetRate(frameRate);
+
+    // a benchmark measures rendering, not waiting for input
+    if (benchmark) {
+        pacer.SetIdleFrames(0);
+    }
+
+    auto pool = std::make_shared<WorkerPool>(0, workerWait);
+    if (!pool->SetAffinity(workerCores)) {
+        std::cerr << "failed to pin workers to the requested cores" << std::endl;
+    }
+
+    // with a batch rasterizer for every pool thread
+    auto rast = Rasterizer::Create(pool->GetThreadCount());
     auto renderer = std::make_unique<ImGuiRenderer>(rast);
+    auto postProcessor = std::make_unique<PostProcessor>(pool);
+    PostProcessSettings postSettings;
+
+    int viewCount = 0;
+    std::unique_ptr<ViewStrip> views;
+
+    // the sessions only get what is left of this much time per frame; with more views queued
+    // than fit, their weights decide who gets how much of it
+    RenderScheduler scheduler(rast, pool);
+    std::vector<std::unique_ptr<Session>> sessions;
+    int sessionWeights[s_SessionCount] = { 1, 3 };
+    float sessionBudget = 1.f;
+
+    MemoryBudget memoryBudget;
+    MemoryDegradation degradation;
+
+    OcclusionQuery sceneQuery;
+    TimestampQueryPool timestamps(16);
+    FrameTimeRecorder frameTimes;
+    LatencyRecorder latency;
+
+    AllocationStats allocations[s_AllocationTagCount];
+    AllocationTracker::EndFrame(allocations);
+
+    std::uint32_t steadyFrames = 0, captureCount = 0;
+    std::uint32_t lastWidth = 0, lastHeight = 0;
 
     std::vector<image_t*> attachments = { nullptr, nullptr };
+    std::vector<image_t*> placedAttachments = { nullptr, nullptr };
     framebuffer fb;
     fb.attachment_count = (uint32_t)attachments.size();
     fb.attachments = attachments.data();
@@ -263,43 +755,37 @@ int main(int argc, const char** argv) {
     pipeline.winding = WINDING_ORDER_CCW;
     pipeline.topology = TOPOLOGY_TYPE_TRIANGLES;
 
-    std::array<Instance, 6> instances;
-    for (std::size_t i = 0; i < instances.size(); i++) {
-        auto& instance = instances[i];
-
-        bool negative = i % 2 == 0;
-        std::size_t primaryAxis = i / 2;
-
-        uint8_t colorValue = negative ? 0x7F : 0xFF;
-        instance.Color = (colorValue << ((primaryAxis + 1) * 8)) | 0xFF;
-
-        std::size_t secondaryAxis = (primaryAxis + 1) % 3;
-        std::size_t tertiaryAxis = (primaryAxis + 2) % 3;
-        float axisValue = negative ? -1.f : 1.f;
-
-        glm::mat4 rotation(0.f);
-        rotation[0][secondaryAxis] = axisValue;
-        rotation[1][tertiaryAxis] = 1.f;
-        rotation[2][primaryAxis] = axisValue;
+    Instances instances;
+    WriteInstances(instances, 0.f);
 
-        glm::mat4 scale = glm::scale(glm::mat4(1.f), glm::vec3(0.25f));
-        glm::mat4 translation = glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, -0.5f));
+    // the simulation thread writes the next set of instances while the frame being drawn reads
+    // the last complete one
+    TripleBuffer<Instances> instanceBuffers(instances);
+    InstanceSimulation simulation(instanceBuffers, s_SimulationRate);
 
-        instance.Model = scale * rotation * translation;
-    }
+    // created once every long-lived thread is running, the pool's workers and the simulation
+    // included; it only counts threads that exist when it looks
+    auto counters = std::make_unique<HardwareCounters>();
+    bool sampleCounters = benchmark != nullptr;
 
-    const std::vector<vertex_buffer> vbufs = {
+    std::vector<vertex_buffer> vbufs = {
         {
             .data = s_Vertices.data(),
             .size = s_Vertices.size() * sizeof(Vertex),
         },
         {
-            .data = instances.data(),
+            .data = instanceBuffers.Acquire().data(),
             .size = instances.size() * sizeof(Instance),
         },
     };
 
-    Uniforms uniforms;
+    // the camera is animated on the input thread and published there after every poll. the scene
+    // reads it through the latch right before drawing, so a camera newer than the frame's start
+    // still makes it into the draw
+    InputState initialState = input.GetState();
+    Uniforms uniforms = ComputeCamera(0.f, initialState.Width, initialState.Height);
+    LateLatch<Uniforms> cameraLatch(uniforms);
+
     indexed_render_call call{};
     call.pipeline = &pipeline;
     call.framebuffer = &fb;
@@ -309,16 +795,132 @@ int main(int argc, const char** argv) {
     call.index_count = (uint32_t)s_Indices.size();
     call.instance_count = (uint32_t)instances.size();
 
-    static const std::vector<image_pixel> clearValues = { { .color = 0x787878FF },
-                                                          { .depth = 1.f } };
+    // the scene itself is drawn one face at a time, so its faces can go front to back: nearer
+    // faces fill the depth buffer first, and the hidden parts of the others fail the depth test
+    // before their fragment stage runs. each face draws its own instance
+    static constexpr std::size_t faceCount = std::tuple_size_v<Instances>;
+
+    std::array<std::array<vertex_buffer, 2>, faceCount> faceVertices;
+    std::array<indexed_render_call, faceCount> faceCalls;
+
+    for (std::size_t i = 0; i < faceCount; i++) {
+        faceVertices[i] = { vbufs[0], { .data = nullptr, .size = sizeof(Instance) } };
 
-    auto t0 = std::chrono::high_resolution_clock::now();
+        faceCalls[i] = call;
+        faceCalls[i].vertices = faceVertices[i].data();
+        faceCalls[i].instance_count = 1;
+    }
+
+    // one list per pool thread; each records the faces it takes
+    std::vector<CommandList> sceneLists(pool->GetThreadCount());
+    std::vector<const CommandList*> sceneListPointers;
+
+    for (const auto& list : sceneLists) {
+        sceneListPointers.push_back(&list);
+    }
+
+    // every thread exists by now, so all of them get a timer
+    SamplingProfiler sampler;
+    if (!profilePath.empty() && !sampler.Start()) {
+        std::cerr << "failed to start the sampling profiler" << std::endl;
+    }
+
+    // from the top of the loop to just before the pacer's wait, so it measures the frame's own
+    // work and not the pacing
+    double frameMilliseconds = 0.0;
+
+    // the animation only advances while frames render, so it picks up where it stopped after
+    // idling. theta and the last sample time belong to the input thread
+    std::atomic<bool> animating = true;
     float cameraTheta = 0.f;
+    auto lastSample = initialState.SampledAt;
+
+    SampleCallbackScope cameraScope(input, [&](const InputState& state) {
+        float elapsed = std::chrono::duration<float>(state.SampledAt - lastSample).count();
+        lastSample = state.SampledAt;
+
+        if (animating.load(std::memory_order_relaxed)) {
+            cameraTheta += elapsed * 0.1f;
+        }
+
+        cameraLatch.Publish(ComputeCamera(cameraTheta, state.Width, state.Height));
+    });
+
+    // the input thread polls at the pacer's idle rate while nothing renders
+    auto inputInterval = input.GetInterval();
+    auto idleInputInterval = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::duration<double>(1.0 / pacer.GetIdleRate()));
+
+    InputState inputState = input.GetState();
+    std::uint32_t width = inputState.Width;
+    std::uint32_t height = inputState.Height;
+    bool closeRequested = false;
+
+    while (!(benchmark && benchmark->IsDone())) {
+        auto frameStart = std::chrono::high_resolution_clock::now();
+
+        // a resize only takes effect here, between frames; the window keeps processing events
+        // while a frame renders at the old size
+        WindowEvent event;
+        bool windowChanged = false;
+
+        while (input.PopEvent(&event)) {
+            if (event.Type == WindowEventType::Close) {
+                closeRequested = true;
+            } else {
+                width = event.Width;
+                height = event.Height;
+                windowChanged = true;
+            }
+        }
+
+        if (closeRequested) {
+            break;
+        }
 
-    while (!window->IsCloseRequested()) {
-        Window::Poll();
+        inputState = input.GetState();
+        latency.Mark(LatencyPoint::InputSampled, inputState.SampledAt);
+
+        std::unique_lock imguiLock(input.GetImGuiMutex());
         ImGui::NewFrame();
 
+        bool render = pacer.ShouldRender(windowChanged || HasInputActivity());
+        if (animating.exchange(render, std::memory_order_relaxed) != render) {
+            input.SetInterval(render ? inputInterval : idleInputInterval);
+        }
+
+        if (!render) {
+            ImGui::EndFrame();
+            imguiLock.unlock();
+
+            pacer.Wait();
+            continue;
+        }
+
+        {
+            AllocationScope scope(AllocationTag::Profiler);
+
+            // picks up any thread started since the last look whenever sampling is switched on
+            if (sampleCounters && timestamps.GetHardwareCounters() == nullptr) {
+                counters->Refresh();
+            }
+
+            timestamps.SetHardwareCounters(sampleCounters ? counters.get() : nullptr);
+            timestamps.BeginFrame();
+            frameTimes.AddStages(timestamps);
+            slowFrames.RecordZones(timestamps);
+
+            if (benchmark) {
+                benchmark->AddFrame(timestamps, (std::uint64_t)fb.width * fb.height);
+            }
+        }
+
+        // the previous frame's time is complete only now, after its stages were resolved
+        if (timestamps.GetFrameIndex() > 1) {
+            frameTimes.AddFrame(timestamps.GetFrameIndex() - 1, frameMilliseconds);
+            slowFrames.EndFrame(timestamps.GetFrameIndex() - 1, frameMilliseconds);
+        }
+
         /* unnecessary
         static bool showDemo = true;
         if (showDemo) {
@@ -326,50 +928,536 @@ int main(int argc, const char** argv) {
         }
         */
 
+        if (ImGui::Begin("Post-processing")) {
+            ImGui::Checkbox("Bloom", &postSettings.Bloom);
+            ImGui::SliderFloat("Bloom threshold", &postSettings.BloomThreshold, 0.f, 1.f);
+            ImGui::SliderFloat("Bloom intensity", &postSettings.BloomIntensity, 0.f, 2.f);
+
+            static const char* const bloomFormats[] = {
+                GetColorFormatName(ColorFormat::RGBA8),
+                GetColorFormatName(ColorFormat::RGB565),
+                GetColorFormatName(ColorFormat::R11G11B10F),
+                GetColorFormatName(ColorFormat::RGBA16F),
+            };
+
+            int bloomFormat = (int)postSettings.BloomFormat;
+            if (ImGui::Combo("Bloom format", &bloomFormat, bloomFormats, 4)) {
+                postSettings.BloomFormat = (ColorFormat)bloomFormat;
+            }
+
+            ImGui::Checkbox("Tonemap", &postSettings.Tonemap);
+            ImGui::SliderFloat("Exposure", &postSettings.Exposure, 0.f, 4.f);
+
+            ImGui::Checkbox("Color grading", &postSettings.ColorGrading);
+            ImGui::SliderFloat("Saturation", &postSettings.Saturation, 0.f, 2.f);
+            ImGui::SliderFloat("Contrast", &postSettings.Contrast, 0.f, 2.f);
+
+            ImGui::Checkbox("FXAA", &postSettings.FXAA);
+        }
+
+        ImGui::End();
+
+        if (ImGui::Begin("Depth")) {
+            ImGui::Text("Samples passed: %llu", (unsigned long long)sceneQuery.GetSampleCount());
+        }
+
+        ImGui::End();
+
+        if (ImGui::Begin("Views")) {
+            ImGui::SliderInt("Count", &viewCount, 0, s_MaxViews);
+
+            bool sessionsEnabled = !sessions.empty();
+            if (ImGui::Checkbox("Sessions", &sessionsEnabled)) {
+                sessions.clear();
+
+                for (std::uint32_t i = 0; sessionsEnabled && i < s_SessionCount; i++) {
+                    sessions.push_back(std::make_unique<Session>(scheduler, sessionWeights[i]));
+                }
+            }
+
+            ImGui::SliderFloat("Budget (ms)", &sessionBudget, 0.f, 10.f);
+
+            double totalBusy = 0.0;
+            for (const auto& session : sessions) {
+                totalBusy += session->GetContext().GetBusyMilliseconds();
+            }
+
+            for (std::uint32_t i = 0; i < (std::uint32_t)sessions.size(); i++) {
+                auto& context = sessions[i]->GetContext();
+
+                ImGui::PushID((int)i);
+                if (ImGui::SliderInt("Weight", &sessionWeights[i], 1, 8)) {
+                    context.SetWeight((std::uint32_t)sessionWeights[i]);
+                }
+                ImGui::PopID();
+
+                double busy = context.GetBusyMilliseconds();
+                ImGui::Text("Session %u: %llu views, %.0f%% of render time", i,
+                            (unsigned long long)context.GetCompletedJobs(),
+                            totalBusy > 0.0 ? busy / totalBusy * 100.0 : 0.0);
+            }
+        }
+
+        ImGui::End();
+
+        if (ImGui::Begin("Timings")) {
+            if (counters->IsAvailable()) {
+                ImGui::Checkbox("Hardware counters", &sampleCounters);
+            } else {
+                ImGui::TextDisabled("Hardware counters unavailable (perf_event_paranoid?)");
+            }
+
+            static const char* const waitPolicies[] = {
+                GetWaitPolicyName(WaitPolicy::Spin),
+                GetWaitPolicyName(WaitPolicy::SpinThenWait),
+                GetWaitPolicyName(WaitPolicy::Block),
+            };
+
+            int waitPolicy = (int)pool->GetWaitPolicy();
+            if (ImGui::Combo("Worker wait", &waitPolicy, waitPolicies, s_WaitPolicyCount)) {
+                pool->SetWaitPolicy((WaitPolicy)waitPolicy);
+            }
+
+            bool physicalCores = !pool->GetAffinity().empty();
+            if (ImGui::Checkbox("Pin workers", &physicalCores)) {
+                pool->SetAffinity(physicalCores ? WorkerPool::GetPhysicalCores()
+                                                : std::vector<std::uint32_t>());
+
+                // the rows' owners moved
+                std::fill(placedAttachments.begin(), placedAttachments.end(), nullptr);
+            }
+
+            if (sampler.IsRunning()) {
+                if (ImGui::Button("Stop sampling")) {
+                    sampler.Stop(profilePath.empty() ? "profile.folded" : profilePath);
+                }
+
+                ImGui::SameLine();
+                ImGui::Text("%u samples", sampler.GetSampleCount());
+            } else if (ImGui::Button("Start sampling") && !sampler.Start()) {
+                std::cerr << "failed to start the sampling profiler" << std::endl;
+            }
+
+            const auto& lastLatency = latency.GetLastFrame();
+            const auto& averageLatency = latency.GetAverage();
+
+            for (std::uint32_t i = 1; i < s_LatencyPointCount; i++) {
+                ImGui::Text("%s: %.3f ms (avg %.3f ms)", GetLatencySegmentName((LatencyPoint)i),
+                            lastLatency.Milliseconds[i] - lastLatency.Milliseconds[i - 1],
+                            averageLatency.Milliseconds[i] - averageLatency.Milliseconds[i - 1]);
+            }
+
+            ImGui::Text("Input to present: %.3f ms (avg %.3f ms, p99 %.3f ms)",
+                        lastLatency.GetTotal(), averageLatency.GetTotal(),
+                        latency.GetTotalPercentile(99.0));
+
+            ImGui::Separator();
+
+            const auto& results = timestamps.GetResults();
+            double pixels = (double)fb.width * fb.height;
+            std::uint32_t threadCount = timestamps.GetResultThreadCount();
+
+            for (std::uint32_t i = 0; i < (std::uint32_t)results.size(); i++) {
+                const auto& result = results[i];
+                ImGui::Text("%s: %.3f ms", result.Name, result.Milliseconds);
+
+                if (threadCount == 0) {
+                    continue;
+                }
+
+                const auto& values = result.Counters;
+                ImGui::Text("  IPC %.2f, L1D %.3f/px, LLC %.4f/px, branch %.3f/px",
+                            values.GetIPC(),
+                            (double)values.Get(HardwareCounter::L1DMisses) / pixels,
+                            (double)values.Get(HardwareCounter::LLCMisses) / pixels,
+                            (double)values.Get(HardwareCounter::BranchMisses) / pixels);
+
+                if (ImGui::TreeNode(result.Name, "%s threads", result.Name)) {
+                    for (std::uint32_t j = 0; j < threadCount; j++) {
+                        const auto& thread = timestamps.GetThreadCounters(i, j);
+                        std::uint64_t cycles = thread.Get(HardwareCounter::Cycles);
+
+                        // idle threads only add noise
+                        if (cycles == 0) {
+                            continue;
+                        }
+
+                        ImGui::Text("%s: %.2f Mcycles, IPC %.2f, LLC %llu",
+                                    counters->GetThreadName(j).c_str(), (double)cycles / 1e6,
+                                    thread.GetIPC(),
+                                    (unsigned long long)thread.Get(HardwareCounter::LLCMisses));
+                    }
+
+                    ImGui::TreePop();
+                }
+            }
+        }
+
+        ImGui::End();
+
+        if (ImGui::Begin("Frame times")) {
+            ImGui::Text("p50 %.2f ms, p90 %.2f ms", frameTimes.GetPercentile(50.0),
+                        frameTimes.GetPercentile(90.0));
+
+            ImGui::Text("p99 %.2f ms, p99.9 %.2f ms", frameTimes.GetPercentile(99.0),
+                        frameTimes.GetPercentile(99.9));
+
+            ImGui::PlotHistogram("Histogram", frameTimes.GetHistogram(),
+                                 (int)FrameTimeRecorder::BucketCount, 0, "0 - 50 ms", 0.f,
+                                 FLT_MAX, ImVec2(0.f, 80.f));
+
+            if (ImGui::SliderInt("Frame limit", &frameRate, 0, 240,
+                                 frameRate == 0 ? "unlimited" : "%d Hz")) {
+                pacer.SetTargetRate(frameRate);
+            }
+
+            if (frameRate > 0) {
+                ImGui::Text("Spin margin: %.2f ms", pacer.GetSpinMarginMilliseconds());
+            }
+
+            float captureBudget = (float)slowFrames.GetBudget();
+            if (ImGui::SliderFloat("Capture over", &captureBudget, 0.f, 100.f, "%.1f ms")) {
+                slowFrames.SetBudget(captureBudget);
+            }
+
+            if (slowFrames.GetCaptureCount() > 0) {
+                ImGui::Text("%u captures, last: %s", slowFrames.GetCaptureCount(),
+                            slowFrames.GetLastCapturePath().c_str());
+            }
+
+            for (std::uint32_t i = 0; i < frameTimes.GetWorstFrameCount(); i++) {
+                const auto& worst = frameTimes.GetWorstFrame(i);
+                if (!ImGui::TreeNode((void*)(std::uintptr_t)worst.Frame, "Frame %llu: %.2f ms",
+                                     (unsigned long long)worst.Frame, worst.Milliseconds)) {
+                    continue;
+                }
+
+                for (std::uint32_t j = 0; j < worst.StageCount; j++) {
+                    ImGui::Text("%s: %.3f ms", worst.Stages[j].Name,
+                                worst.Stages[j].Milliseconds);
+                }
+
+                ImGui::TreePop();
+            }
+        }
+
+        ImGui::End();
+
+        if (ImGui::Begin("Memory")) {
+            static constexpr double mib = 1024.0 * 1024.0;
+
+            for (std::uint32_t i = 0; i < s_MemoryCategoryCount; i++) {
+                auto category = (MemoryCategory)i;
+
+                int budget = (int)(memoryBudget.GetBudget(category) / (1024 * 1024));
+                ImGui::Text("%s: %.1f MiB%s", GetMemoryCategoryName(category),
+                            (double)memoryBudget.GetUsage(category) / mib,
+                            memoryBudget.IsOverBudget(category) ? " (over budget)" : "");
+
+                if (category == MemoryCategory::Attachments) {
+                    continue;
+                }
+
+                if (ImGui::SliderInt(GetMemoryCategoryName(category), &budget, 0, 1024,
+                                     "%d MiB budget")) {
+                    memoryBudget.SetBudget(category, (std::size_t)budget * 1024 * 1024);
+                }
+            }
+
+            ImGui::Separator();
+            ImGui::Text("Resident: %.1f MiB", (double)memoryBudget.GetResidentBytes() / mib);
+
+            if (memoryBudget.GetContainerLimit() > 0) {
+                ImGui::Text("Container limit: %.1f MiB%s",
+                            (double)memoryBudget.GetContainerLimit() / mib,
+                            memoryBudget.IsUnderPressure() ? " (under pressure)" : "");
+            }
+
+            PostProcessSettings applied = degradation.Apply(postSettings);
+            ImGui::Text("Bloom: %s, downscale %u", applied.Bloom ? "on" : "off",
+                        applied.BloomDownscale);
+            ImGui::Text("Huge pages: %s", GetHugePageModeName(HugePages::GetMode()));
+        }
+
+        ImGui::End();
+
+        if (AllocationTracker::IsAvailable()) {
+            if (ImGui::Begin("Allocations")) {
+                for (std::uint32_t i = 0; i < s_AllocationTagCount; i++) {
+                    ImGui::Text("%s: %llu (%llu bytes)", GetAllocationTagName((AllocationTag)i),
+                                (unsigned long long)allocations[i].Count,
+                                (unsigned long long)allocations[i].Bytes);
+                }
+            }
+
+            ImGui::End();
+        }
+
         ImGui::Render();
+        imguiLock.unlock();
+
+        fb.width = width;
+        fb.height = height;
+
+        // the window's backbuffer belongs to the input thread, which may reallocate it while
+        // this frame renders; the frame goes to a color attachment of its own instead
+        ValidateAttachment(fb.width, fb.height, IMAGE_FORMAT_COLOR, &attachments[0]);
+        ValidateAttachment(fb.width, fb.height, IMAGE_FORMAT_DEPTH, &attachments[1]);
+
+        // nothing to draw into while the window is minimized or an allocation failed
+        if (attachments[0] == nullptr || attachments[1] == nullptr) {
+            auto frameTime = std::chrono::high_resolution_clock::now() - frameStart;
+            frameMilliseconds = std::chrono::duration<double, std::milli>(frameTime).count();
+
+            pacer.Wait();
+            continue;
+        }
+
+        if (fb.width != lastWidth || fb.height != lastHeight) {
+            degradation.Forget();
+        }
+
+        // image_allocate leaves every page on the node of whichever thread touched it first;
+        // move the rows to the workers that process them, then let those workers fault in the
+        // rest as huge pages
+        bool placementStale = fb.width != lastWidth || fb.height != lastHeight;
+        for (std::size_t i = 0; i < attachments.size(); i++) {
+            if (placementStale || attachments[i] != placedAttachments[i]) {
+                auto image = attachments[i];
+                std::size_t rowBytes = (std::size_t)image->width * sizeof(image_pixel);
+
+                pool->PlaceRows(image->data, rowBytes, image->height);
+                HugePages::Back(*pool, image->data, rowBytes * image->height);
+
+                placedAttachments[i] = image;
+            }
+        }
+
+        {
+            TimestampScope scope(timestamps, "Clear");
+            rast->ClearFramebuffer(&fb, s_ClearValues);
+        }
+
+        const Instances& currentInstances = instanceBuffers.Acquire();
+        vbufs[1].data = currentInstances.data();
+
+        {
+            TimestampScope scope(timestamps, "Recording");
+
+            // the order only needs a recent camera; the draws still latch the newest one
+            Uniforms sortCamera = cameraLatch.Get();
 
-        window->GetFramebufferSize(&fb.width, &fb.height);
-        float aspect = (float)fb.width / (float)fb.height;
+            for (auto& list : sceneLists) {
+                list.Reset();
+            }
 
-        attachments[0] = window->GetBackbuffer();
-        ValidateDepthBuffer(*window, &attachments[1]);
+            auto recordFace = [&](std::uint32_t i, std::uint32_t thread) {
+                const auto& instance = currentInstances[i];
+                faceVertices[i][1].data = &instance;
 
-        auto t1 = std::chrono::high_resolution_clock::now();
-        auto delta = std::chrono::duration_cast<std::chrono::duration<float>>(t1 - t0);
-        t0 = t1;
+                // distances are positive, and positive floats order like their bits. the face
+                // index breaks ties, so the order does not depend on which thread took which face
+                glm::vec4 center = sortCamera.View * instance.Model * glm::vec4(0.f, 0.f, 0.f, 1.f);
+                float distance = glm::length(glm::vec3(center));
 
-        float cosTheta = glm::cos(cameraTheta);
-        float sinTheta = glm::sin(cameraTheta);
+                std::uint32_t distanceBits;
+                memcpy(&distanceBits, &distance, sizeof(distanceBits));
 
-        float phi = cosTheta * std::numbers::pi_v<float> / 4.f;
-        float cosPhi = glm::cos(phi);
-        float sinPhi = glm::sin(phi);
+                sceneLists[thread].Record(((std::uint64_t)distanceBits << 32) | i, faceCalls[i]);
+            };
 
-        cameraTheta += delta.count() * 0.1f;
-        float cameraDistance = 10.f;
+            pool->ParallelForThreads((std::uint32_t)faceCount, recordFace);
+        }
 
-        glm::vec3 eye = { cosTheta * cosPhi * cameraDistance, sinPhi * cameraDistance,
-                          sinTheta * cosPhi * cameraDistance };
+        latency.Mark(LatencyPoint::UniformsUpdated);
 
-        static const glm::vec3 center = glm::vec3(0.f);
-        static const glm::vec3 up = glm::vec3(0.f, -1.f, 0.f);
+        {
+            TimestampScope scope(timestamps, "Scene");
 
-        uniforms.Projection = glm::perspective(glm::radians(45.f), aspect, 0.1f, 100.f);
-        uniforms.View = LookAt(eye, center, up);
+            rast->BeginQuery(sceneQuery);
+            rast->BeginLateLatch(cameraLatch);
+            rast->ExecuteCommandLists(sceneListPointers);
+            rast->EndLateLatch();
+            rast->EndQuery();
+        }
+
+        for (const auto& faceCall : faceCalls) {
+            slowFrames.RecordDraw(timestamps.GetFrameIndex(), "Scene", faceCall);
+        }
 
-        rast->ClearFramebuffer(&fb, clearValues);
-        rast->RenderIndexed(call);
-        renderer->Render(ImGui::GetDrawData(), &fb);
+        slowFrames.RecordCounter(timestamps.GetFrameIndex(), "Samples passed",
+                                 (double)sceneQuery.GetSampleCount());
+
+        {
+            TimestampScope scope(timestamps, "Post-processing");
+            AllocationScope allocationScope(AllocationTag::PostProcess);
+
+            postProcessor->Process(attachments[0], degradation.Apply(postSettings));
+        }
+
+        if (views == nullptr || views->GetCount() != (std::uint32_t)viewCount) {
+            views = viewCount > 0 ? std::make_unique<ViewStrip>((std::uint32_t)viewCount) : nullptr;
+        }
+
+        if (views != nullptr) {
+            TimestampScope scope(timestamps, "Views");
+
+            views->Update(call, 0.f);
+            rast->RenderBatch(*pool, views->GetJobs());
+            views->CopyTo(attachments[0], s_ViewGap);
+        }
+
+        if (!sessions.empty()) {
+            TimestampScope scope(timestamps, "Sessions");
+
+            for (auto& session : sessions) {
+                session->Submit(call, 0.f);
+            }
+
+            auto budget = std::chrono::duration<float, std::milli>(sessionBudget);
+            scheduler.Execute(std::chrono::high_resolution_clock::now() +
+                              std::chrono::duration_cast<RenderScheduler::Clock::duration>(budget));
+
+            // one row per session, below the main strip
+            for (std::uint32_t i = 0; i < (std::uint32_t)sessions.size(); i++) {
+                std::uint32_t row = s_ViewGap + (i + 1) * (s_ViewSize + s_ViewGap);
+                sessions[i]->GetViews().CopyTo(attachments[0], row);
+            }
+        }
+
+        {
+            TimestampScope scope(timestamps, "ImGui");
+            AllocationScope allocationScope(AllocationTag::UI);
+
+            renderer->Render(ImGui::GetDrawData(), &fb);
+        }
 
-        window->SwapBuffers();
+        latency.Mark(LatencyPoint::RasterComplete);
+
+        input.Present(attachments[0]);
+        latency.Mark(LatencyPoint::Presented);
+        latency.EndFrame();
+
+        if (benchmark) {
+            benchmark->AddLatency(latency.GetLastFrame());
+        }
+
+        memoryBudget.SetUsage(MemoryCategory::Attachments,
+                              (std::size_t)fb.width * fb.height * sizeof(image_pixel) *
+                                  attachments.size());
+
+        memoryBudget.SetUsage(MemoryCategory::PostProcess, postProcessor->GetMemoryUsage());
+        memoryBudget.Update();
+
+        slowFrames.RecordCounter(timestamps.GetFrameIndex(), "Resident MiB",
+                                 (double)memoryBudget.GetResidentBytes() / (1024.0 * 1024.0));
+
+        bool degraded = degradation.Update(memoryBudget, postSettings);
+
+        AllocationTracker::EndFrame(allocations);
+
+        // resizes, settings changes and slow-frame captures allocate on purpose; start counting
+        // again after them
+        bool resized = fb.width != lastWidth || fb.height != lastHeight;
+        bool captured = slowFrames.GetCaptureCount() != captureCount;
+        captureCount = slowFrames.GetCaptureCount();
+
+        bool reset = resized || degraded || captured || ImGui::IsAnyItemActive();
+        steadyFrames = reset ? 0 : steadyFrames + 1;
+
+        lastWidth = fb.width;
+        lastHeight = fb.height;
+
+        // ui allocations are left out; imgui grows its buffers whenever a window appears
+        if (s_IsDebug && steadyFrames > s_AllocationWarmupFrames) {
+            for (std::uint32_t i = 0; i < s_AllocationTagCount; i++) {
+                if ((AllocationTag)i == AllocationTag::UI || allocations[i].Count == 0) {
+                    continue;
+                }
+
+                std::cerr << GetAllocationTagName((AllocationTag)i) << " allocated "
+                          << allocations[i].Count << " times (" << allocations[i].Bytes
+                          << " bytes) in a steady-state frame" << std::endl;
+
+                assert(false && "the render loop must not allocate once warmed up");
+            }
+        }
+
+        auto frameTime = std::chrono::high_resolution_clock::now() - frameStart;
+        frameMilliseconds = std::chrono::duration<double, std::milli>(frameTime).count();
+
+        pacer.Wait();
+    }
+
+    if (sampler.IsRunning()) {
+        sampler.Stop(profilePath.empty() ? "profile.folded" : profilePath);
     }
 
-    image_free(attachments[1]);
+    if (benchmark) {
+        if (benchmarkPath.empty()) {
+            benchmark->WriteJSON(std::cout);
+        } else {
+            std::ofstream stream(benchmarkPath);
+            benchmark->WriteJSON(stream);
+        }
+    }
+
+    if (!frameTimesPath.empty()) {
+        std::ofstream stream(frameTimesPath);
+        frameTimes.WriteCSV(stream);
+    }
+
+    for (image_t* attachment : attachments) {
+        image_free(attachment);
+    }
+
+    views.reset();
+    sessions.clear();
+    postProcessor.reset();
+    pool.reset();
 
     renderer.reset();
+    rast.reset();
+    return 0;
+}
+
+int main(int argc, const char** argv) {
+    auto window = Window::Create("Test", 1600, 900);
+
+    IMGUI_CHECKVERSION();
+    ImGui::SetAllocatorFunctions(ImGuiAllocate, ImGuiFree);
+    ImGui::CreateContext();
+
+    window->InitImGui();
+
+    // the thread that created the window keeps polling it and presents the frames the render
+    // thread hands over
+    InputThread input(window->Get());
+
+    int result = 1;
+    std::exception_ptr error;
+
+    std::thread renderThread([&]() {
+        pthread_setname_np(pthread_self(), "render");
+
+        try {
+            result = RunRenderer(argc, argv, input);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        input.Stop();
+    });
+
+    input.Run();
+    renderThread.join();
+
     window.reset();
     ImGui::DestroyContext();
 
-    rast.reset();
-    return 0;
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    return result;
 }